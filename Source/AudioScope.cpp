@@ -0,0 +1,74 @@
+/*
+  ==============================================================================
+
+    AudioScope.cpp
+    Created: 18 Oct 2026 4:02:16pm
+    Author:  MacJay
+
+  ==============================================================================
+*/
+
+#include "AudioScope.h"
+
+AudioScope::AudioScope() : samples(size_t(fifoSize), 0.0f) {}
+
+void AudioScope::setSampleRate(double newSampleRate)
+{
+    sampleRate.store(newSampleRate);
+}
+
+void AudioScope::push(const float* left, const float* right, int numSamples)
+{
+//    The only cost while nobody is looking.
+    if (!enabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    int produced = (count + numSamples) / decimation;
+    if (produced > fifo.getFreeSpace()) {
+        sum = 0.0f;
+        count = 0;
+        return;
+    }
+
+//    The FIFO gives out up to two blocks, because the
+//    free space may wrap around the end of the buffer.
+    const auto scope = fifo.write(produced);
+    int written = 0;
+    for (int i = 0; i < numSamples; ++i) {
+//        Mono mix. The average over `decimation` samples is a
+//        simple low-pass filter that reduces aliasing.
+        sum += (right != nullptr) ? 0.5f * (left[i] + right[i]) : left[i];
+        if (++count == decimation) {
+            int index = (written < scope.blockSize1)
+                        ? scope.startIndex1 + written
+                        : scope.startIndex2 + written - scope.blockSize1;
+            samples[size_t(index)] = sum / float(decimation);
+            written += 1;
+            sum = 0.0f;
+            count = 0;
+        }
+    }
+}
+
+void AudioScope::setEnabled(bool shouldBeEnabled)
+{
+    if (shouldBeEnabled) {
+//        Throws away whatever was left from the last time.
+//        Reading is the reader's job, so this is safe.
+        fifo.read(fifo.getNumReady());
+    }
+    enabled.store(shouldBeEnabled);
+}
+
+int AudioScope::pull(float* destination, int maxSamples)
+{
+    const auto scope = fifo.read(juce::jmin(maxSamples, fifo.getNumReady()));
+    if (scope.blockSize1 > 0) {
+        std::copy_n(samples.data() + scope.startIndex1, scope.blockSize1, destination);
+    }
+    if (scope.blockSize2 > 0) {
+        std::copy_n(samples.data() + scope.startIndex2, scope.blockSize2, destination + scope.blockSize1);
+    }
+    return scope.blockSize1 + scope.blockSize2;
+}
@@ -0,0 +1,61 @@
+/*
+  ==============================================================================
+
+    AudioScope.h
+    Created: 18 Oct 2026 4:02:16pm
+    Author:  MacJay
+
+    Hands the output of the synth from the audio thread to the editor's
+    oscilloscope and spectrum analyzer.
+
+    The audio thread is the only writer and the editor's timer the only
+    reader, so a juce::AbstractFifo is enough: it's wait-free and
+    doesn't lock. The samples are mixed down to mono and decimated
+    before they go into the FIFO, which keeps the amount of data small.
+
+    The editor switches the scope on and off. While it's off, which is
+    whenever the editor is closed, push() only checks an atomic flag.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class AudioScope
+{
+public:
+//    Every `decimation` output samples become one scope sample.
+    static constexpr int decimation = 2;
+    static constexpr int fifoSize = 16384;
+
+    AudioScope();
+
+//    Called from prepareToPlay().
+    void setSampleRate(double sampleRate);
+
+//    Sample rate of the scope samples.
+    double getScopeSampleRate() const { return sampleRate.load() / decimation; }
+
+//    Audio thread. Never allocates or locks. If the reader
+//    falls behind, the block is dropped.
+    void push(const float* left, const float* right, int numSamples);
+
+//    Reader side, for the editor on the message thread.
+    void setEnabled(bool enabled);
+    int pull(float* destination, int maxSamples);
+
+private:
+    std::atomic<bool> enabled {false};
+    std::atomic<double> sampleRate {44100.0};
+
+    juce::AbstractFifo fifo {fifoSize};
+    std::vector<float> samples;
+
+//    Decimation state, only used by the audio thread.
+    float sum = 0.0f;
+    int count = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioScope)
+};
@@ -0,0 +1,57 @@
+/*
+  ==============================================================================
+
+    EditorSections.h
+    Created: 18 Oct 2026 4:02:51pm
+    Author:  MacJay
+
+    Two small helpers that let the editor put off work until the user
+    actually needs it, so opening the editor stays quick.
+
+    SectionViewport tells the editor which part of the content is on
+    screen, so panels below the fold are only created when scrolled to.
+    PresetSelector fills its list right before the popup opens.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+*/
+class SectionViewport : public juce::Viewport
+{
+public:
+//    Called with the visible part of the viewed component,
+//    in that component's coordinates.
+    std::function<void(juce::Rectangle<int>)> onVisibleAreaChanged;
+
+    void visibleAreaChanged(const juce::Rectangle<int>& newVisibleArea) override
+    {
+        if (onVisibleAreaChanged) {
+            onVisibleAreaChanged(newVisibleArea);
+        }
+    }
+};
+
+//==============================================================================
+/*
+*/
+class PresetSelector : public juce::ComboBox
+{
+public:
+//    Fills the list. Until the first popup the combo box
+//    only shows the name of the current preset as text.
+    std::function<void()> onShowPopup;
+
+    void showPopup() override
+    {
+        if (onShowPopup) {
+            onShowPopup();
+        }
+        juce::ComboBox::showPopup();
+    }
+};
@@ -68,6 +68,25 @@ public:
         return target >= 2.0f;
     }
     
+//    The phase of the envelope. Only used for displaying
+//    it, the envelope itself doesn't need to know.
+    enum Stage { IDLE = 0, ATTACK, DECAY, RELEASE };
+    
+    Stage getStage() const
+    {
+        if (!isActive()) {
+            return IDLE;
+        }
+        if (isInAttack()) {
+            return ATTACK;
+        }
+//        Decay and sustain share the decay multiplier.
+        if (target == 0.0f && multiplier == releaseMultiplier) {
+            return RELEASE;
+        }
+        return DECAY;
+    }
+    
 //    Setting target to 2.0f and activating
 //    the attackMultiplier. level guarantees
 //    that the initial attack level is above
@@ -0,0 +1,147 @@
+/*
+  ==============================================================================
+
+    KnobAttachment.cpp
+    Created: 18 Oct 2026 2:47:52pm
+    Author:  MacJay
+
+  ==============================================================================
+*/
+
+#include "KnobAttachment.h"
+
+//Changes smaller than this (in the 0 - 1 range of the parameter)
+//don't move the knob by a visible amount and are skipped.
+static constexpr float visibleStep = 0.001f;
+
+//==============================================================================
+KnobUpdateScheduler::KnobUpdateScheduler(int framesPerSecond)
+{
+    startTimerHz(framesPerSecond);
+}
+
+KnobUpdateScheduler::~KnobUpdateScheduler()
+{
+    stopTimer();
+}
+
+int KnobUpdateScheduler::add(KnobAttachment* attachment)
+{
+//    The dirty set has one bit per knob.
+    jassert(attachments.size() < 64);
+    attachments.push_back(attachment);
+    return int(attachments.size()) - 1;
+}
+
+void KnobUpdateScheduler::remove(int index)
+{
+//    The slot stays, so the other knobs keep their bits.
+    attachments[size_t(index)] = nullptr;
+}
+
+void KnobUpdateScheduler::timerCallback()
+{
+    uint64_t changed = dirty.exchange(0);
+    for (size_t i = 0; changed != 0; ++i, changed >>= 1) {
+        if ((changed & 1) != 0 && attachments[i] != nullptr) {
+            attachments[i]->updateSlider();
+        }
+    }
+}
+
+//==============================================================================
+KnobAttachment::KnobAttachment(KnobUpdateScheduler& scheduler_,
+                               juce::AudioProcessorValueTreeState& apvts,
+                               const juce::String& parameterID,
+                               juce::Slider& slider_)
+    : scheduler(scheduler_),
+      parameter(*apvts.getParameter(parameterID)),
+      slider(slider_)
+{
+//    The same slider setup as APVTS::SliderAttachment: the range,
+//    text conversion and default value come from the parameter.
+    slider.valueFromTextFunction = [this](const juce::String& text) {
+        return double(parameter.convertFrom0to1(parameter.getValueForText(text)));
+    };
+    slider.textFromValueFunction = [this](double value) {
+        return parameter.getText(parameter.convertTo0to1(float(value)), 0);
+    };
+    slider.setDoubleClickReturnValue(true, parameter.convertFrom0to1(parameter.getDefaultValue()));
+
+    auto range = parameter.getNormalisableRange();
+    juce::NormalisableRange<double> sliderRange {
+        double(range.start), double(range.end),
+        [range](double, double, double normalised) {
+            return double(range.convertFrom0to1(float(normalised)));
+        },
+        [range](double, double, double value) {
+            return double(range.convertTo0to1(float(value)));
+        },
+        [range](double, double, double value) {
+            return double(range.snapToLegalValue(float(value)));
+        }
+    };
+    sliderRange.interval = range.interval;
+    sliderRange.skew = range.skew;
+    sliderRange.symmetricSkew = range.symmetricSkew;
+    slider.setNormalisableRange(sliderRange);
+
+    index = scheduler.add(this);
+    updateSlider();
+
+    parameter.addListener(this);
+    slider.addListener(this);
+}
+
+KnobAttachment::~KnobAttachment()
+{
+    slider.removeListener(this);
+    parameter.removeListener(this);
+    scheduler.remove(index);
+}
+
+void KnobAttachment::updateSlider()
+{
+    float value = parameter.getValue();
+    float shown = parameter.convertTo0to1(float(slider.getValue()));
+    if (std::abs(value - shown) < visibleStep) {
+        return;
+    }
+
+    const juce::ScopedValueSetter<bool> svs(ignoreCallbacks, true);
+    slider.setValue(parameter.convertFrom0to1(value), juce::sendNotificationSync);
+}
+
+void KnobAttachment::parameterValueChanged(int, float)
+{
+    scheduler.markDirty(index);
+}
+
+void KnobAttachment::sliderValueChanged(juce::Slider*)
+{
+    if (ignoreCallbacks) {
+        return;
+    }
+
+    float value = parameter.convertTo0to1(float(slider.getValue()));
+
+//    Dragging the knob is already wrapped in a gesture. Other
+//    changes, such as typing a value, are a gesture of their own.
+    if (slider.isMouseButtonDown()) {
+        parameter.setValueNotifyingHost(value);
+    } else {
+        parameter.beginChangeGesture();
+        parameter.setValueNotifyingHost(value);
+        parameter.endChangeGesture();
+    }
+}
+
+void KnobAttachment::sliderDragStarted(juce::Slider*)
+{
+    parameter.beginChangeGesture();
+}
+
+void KnobAttachment::sliderDragEnded(juce::Slider*)
+{
+    parameter.endChangeGesture();
+}
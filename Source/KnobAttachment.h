@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    KnobAttachment.h
+    Created: 18 Oct 2026 2:47:52pm
+    Author:  MacJay
+
+    Connects a parameter to a knob like APVTS::SliderAttachment, but
+    doesn't update the knob on every parameter change. Dense host
+    automation can change a parameter hundreds of times per second,
+    and with 26 knobs that floods the message thread with repaints.
+
+    A change only marks the knob as dirty in an atomic bit set, which
+    is safe from any thread. KnobUpdateScheduler looks at the set on
+    a timer and updates all dirty knobs in one go. Knobs whose value
+    hasn't visibly changed are not touched at all.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class KnobAttachment;
+
+class KnobUpdateScheduler : private juce::Timer
+{
+public:
+    explicit KnobUpdateScheduler(int framesPerSecond = 30);
+    ~KnobUpdateScheduler() override;
+
+private:
+    friend class KnobAttachment;
+
+//    Returns the bit that the attachment uses in the dirty set.
+    int add(KnobAttachment* attachment);
+    void remove(int index);
+
+//    Called on whatever thread changed the parameter.
+    void markDirty(int index)
+    {
+        dirty.fetch_or(uint64_t(1) << index);
+    }
+
+    void timerCallback() override;
+
+    std::vector<KnobAttachment*> attachments;
+    std::atomic<uint64_t> dirty {0};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (KnobUpdateScheduler)
+};
+
+class KnobAttachment : private juce::AudioProcessorParameter::Listener,
+                       private juce::Slider::Listener
+{
+public:
+    KnobAttachment(KnobUpdateScheduler& scheduler,
+                   juce::AudioProcessorValueTreeState& apvts,
+                   const juce::String& parameterID,
+                   juce::Slider& slider);
+    ~KnobAttachment() override;
+
+//    Moves the knob to the current value of the parameter.
+//    Message thread only.
+    void updateSlider();
+
+private:
+    void parameterValueChanged(int parameterIndex, float newValue) override;
+    void parameterGestureChanged(int, bool) override {}
+
+    void sliderValueChanged(juce::Slider* slider) override;
+    void sliderDragStarted(juce::Slider* slider) override;
+    void sliderDragEnded(juce::Slider* slider) override;
+
+    KnobUpdateScheduler& scheduler;
+    juce::RangedAudioParameter& parameter;
+    juce::Slider& slider;
+    int index;
+
+//    True while the knob is moved by updateSlider(), so
+//    the change isn't sent back to the parameter.
+    bool ignoreCallbacks = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (KnobAttachment)
+};
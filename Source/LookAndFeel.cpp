@@ -13,11 +13,9 @@
 LookAndFeel::LookAndFeel() 
 {
 //    Using font from BinaryData
-//    It constructs a new juce::Typeface object from the pointer to the
-//    font data, and then makes it the standard font.
-    juce::Typeface::Ptr typeface = juce::Typeface::createSystemTypefaceFor(
-                    BinaryData::LatoMedium_ttf, BinaryData::LatoMedium_ttfSize);
-    setDefaultSansSerifTypeface(typeface);
+//    The typeface is created once for all instances,
+//    here it only becomes the standard font.
+    setDefaultSansSerifTypeface(shared->getTypeface());
     
 //    Slider
     setColour(juce::ResizableWindow::backgroundColourId, juce::Colour(65, 70, 80));
@@ -33,6 +31,17 @@ LookAndFeel::LookAndFeel()
     setColour(juce::ComboBox::outlineColourId, juce::Colour(180, 180, 180));
 }
 
+//Knob geometry, shared by the cached background and the live drawing.
+static juce::Rectangle<float> getKnobBounds(int x, int y, int width, int height)
+{
+    return juce::Rectangle<int> (x, y, width, height).toFloat().reduced (10);
+}
+
+static float getKnobRadius(juce::Rectangle<float> bounds)
+{
+    return juce::jmin (bounds.getWidth(), bounds.getHeight()) / 2.0f;
+}
+
 void LookAndFeel::drawRotarySlider(juce::Graphics& g, int x, int y, int width, int height,
                       float sliderPos, float rotaryStartAngle,
                       float rotaryEndAngle, juce::Slider& slider) 
@@ -40,29 +49,18 @@ void LookAndFeel::drawRotarySlider(juce::Graphics& g, int x, int y, int width, i
     auto outline = slider.findColour (juce::Slider::rotarySliderOutlineColourId);
     auto fill    = slider.findColour (juce::Slider::rotarySliderFillColourId);
 
-    auto bounds = juce::Rectangle<int> (x, y, width, height).toFloat().reduced (10);
+    auto bounds = getKnobBounds (x, y, width, height);
 
-    auto radius = juce::jmin (bounds.getWidth(), bounds.getHeight()) / 2.0f;
+    auto radius = getKnobRadius (bounds);
     auto toAngle = rotaryStartAngle + sliderPos * (rotaryEndAngle - rotaryStartAngle);
     auto lineW = juce::jmin (8.0f, radius * 0.1f);
     auto arcRadius = radius - lineW * 0.5f;
     
-
-//    Created Dial path background.
-    juce::Path backgroundArc;
-//    Adding centered arc.
-    backgroundArc.addCentredArc (bounds.getCentreX(),
-                                 bounds.getCentreY(),
-                                 arcRadius,
-                                 arcRadius,
-                                 0.0f,
-                                 rotaryStartAngle,
-                                 rotaryEndAngle,
-                                 true);
-//    Set color.
-    g.setColour (outline);
-//    Drawing the arc.
-    g.strokePath (backgroundArc, juce::PathStrokeType (lineW, juce::PathStrokeType::curved, juce::PathStrokeType::rounded));
+//    Dial path background, prerendered at the resolution of the display.
+    float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    const juce::Image& backgroundArc = getBackgroundArc (width, height, scale,
+                                                         rotaryStartAngle, rotaryEndAngle, outline);
+    g.drawImage (backgroundArc, juce::Rectangle<int> (x, y, width, height).toFloat());
 
     if (slider.isEnabled())
     {
@@ -87,7 +85,57 @@ void LookAndFeel::drawRotarySlider(juce::Graphics& g, int x, int y, int width, i
         bounds.getCentreY() + (arcRadius- 10.0f) * std::sin (toAngle - juce::MathConstants<float>::halfPi));
 //    Color of the point.
     g.setColour (slider.findColour (juce::Slider::thumbColourId));
-//    Drawing a circle:
 //    Drawing a pointer from the center of the arc to the thumb
-    g.drawLine(backgroundArc.getBounds().getCentreX(), backgroundArc.getBounds().getCentreY(), thumbPoint.getX(), thumbPoint.getY(), lineW);
+    g.drawLine(bounds.getCentreX(), bounds.getCentreY(), thumbPoint.getX(), thumbPoint.getY(), lineW);
+}
+
+const juce::Image& LookAndFeel::getBackgroundArc(int width, int height, float scale,
+                                                 float rotaryStartAngle, float rotaryEndAngle,
+                                                 juce::Colour colour)
+{
+    auto& arcCache = shared->knobImages;
+    for (const auto& arc : arcCache) {
+        if (arc.width == width && arc.height == height && arc.scale == scale
+                && arc.startAngle == rotaryStartAngle && arc.endAngle == rotaryEndAngle
+                && arc.colour == colour) {
+            return arc.image;
+        }
+    }
+    
+    if (arcCache.size() >= maxCachedArcs) {
+        arcCache.clear();
+    }
+    
+    juce::Image image (juce::Image::ARGB,
+                       juce::jmax (1, juce::roundToInt (float(width) * scale)),
+                       juce::jmax (1, juce::roundToInt (float(height) * scale)),
+                       true);
+    {
+        juce::Graphics g (image);
+        g.addTransform (juce::AffineTransform::scale (scale));
+        
+        auto bounds = getKnobBounds (0, 0, width, height);
+        auto radius = getKnobRadius (bounds);
+        auto lineW = juce::jmin (8.0f, radius * 0.1f);
+        auto arcRadius = radius - lineW * 0.5f;
+        
+//        Created Dial path background.
+        juce::Path backgroundArc;
+//        Adding centered arc.
+        backgroundArc.addCentredArc (bounds.getCentreX(),
+                                     bounds.getCentreY(),
+                                     arcRadius,
+                                     arcRadius,
+                                     0.0f,
+                                     rotaryStartAngle,
+                                     rotaryEndAngle,
+                                     true);
+//        Set color.
+        g.setColour (colour);
+//        Drawing the arc.
+        g.strokePath (backgroundArc, juce::PathStrokeType (lineW, juce::PathStrokeType::curved, juce::PathStrokeType::rounded));
+    }
+    
+    arcCache.push_back ({ width, height, scale, rotaryStartAngle, rotaryEndAngle, colour, image });
+    return arcCache.back().image;
 }
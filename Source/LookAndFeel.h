@@ -10,6 +10,7 @@
 
 #pragma once
 #include <JuceHeader.h>
+#include "SharedResources.h"
 
 class LookAndFeel : public juce::LookAndFeel_V4 {
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LookAndFeel)
@@ -21,4 +22,22 @@ public:
     void drawRotarySlider(juce::Graphics& g, int x, int y, int width, int height,
                           float sliderPos, float rotaryStartAngle,
                           float rotaryEndAngle, juce::Slider& slider) override;
+    
+private:
+//    Typeface and knob images, shared by all editors.
+    juce::SharedResourcePointer<SharedResources> shared;
+    
+//    The background arc only depends on the size of the knob,
+//    the display scale, the angles and the colour. All knobs have
+//    the same size, so it is rendered into an image once and then
+//    only copied. Only the value arc and the pointer are drawn
+//    on every repaint. The images are kept in SharedResources.
+    
+//    More sizes than this would mean the window is being resized,
+//    and then the old images are of no use anymore.
+    static constexpr size_t maxCachedArcs = 8;
+    
+    const juce::Image& getBackgroundArc(int width, int height, float scale,
+                                        float rotaryStartAngle, float rotaryEndAngle,
+                                        juce::Colour colour);
 };
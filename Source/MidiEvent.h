@@ -0,0 +1,173 @@
+/*
+  ==============================================================================
+
+    MidiEvent.h
+    Created: 18 Oct 2026 5:12:40pm
+    Author:  MacJay
+
+    The internal format of incoming MIDI. Velocities, controllers,
+    pressure and pitch bend are kept at 32 bits, the resolution of
+    MIDI 2.0. MIDI 1.0 values are scaled up the way the MIDI 2.0
+    specification does it (min-center-max), so 0, the center and
+    the maximum stay exactly where they were.
+
+    Events are read straight from the incoming MIDI 1.0 bytes, nothing
+    is copied into a juce::MidiMessage. The plug-in gets its MIDI from
+    a juce::MidiBuffer, which only holds MIDI 1.0, so there is no
+    Universal MIDI Packet reader.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstdint>
+
+struct MidiEvent {
+//    The command in the high nibble, as in a MIDI 1.0 status byte:
+//    0x80 Note Off, 0x90 Note On, 0xA0 Poly Pressure, 0xB0 Control
+//    Change, 0xC0 Program Change, 0xD0 Channel Pressure, 0xE0 Pitch
+//    Bend. 0 means the message isn't one of these and is ignored.
+    uint8_t status = 0;
+    uint8_t channel = 0;
+//    Note, controller or program number.
+    uint8_t index = 0;
+//    Velocity, controller value, pressure or pitch bend.
+    uint32_t value = 0;
+
+//    The value from 0 to 1.
+    float unipolar() const { return float(double(value) / 4294967295.0); }
+    
+//    The reverse of unipolar(), for events that don't come from
+//    MIDI bytes, such as the on-screen keyboard.
+    static uint32_t fromUnipolar(float position)
+    {
+        double clamped = (position < 0.0f) ? 0.0 : (position > 1.0f) ? 1.0 : double(position);
+        return uint32_t(clamped * 4294967295.0 + 0.5);
+    }
+    
+//    The value from -1 to 1, exactly 0 in the center. For pitch bend.
+//    Each half is scaled on its own, the reverse of scaleUp().
+    float bipolar() const
+    {
+        if (value <= center) {
+            return float(double(value) / double(center)) - 1.0f;
+        }
+        return float(double(value - center) / double(center - 1));
+    }
+    
+//    The value from 0 to 127, with the fractions that MIDI 1.0 can't
+//    send. Each 7-bit value comes back exactly, so the formulas
+//    written for MIDI 1.0 keep working.
+    float asMidi1() const { return 64.0f + bipolar() * ((value <= center) ? 64.0f : 63.0f); }
+    
+    static constexpr uint32_t center = 0x80000000u;
+
+//    Min-center-max upscaling from the MIDI 2.0 specification.
+//    Values up to the center are shifted, the upper half repeats
+//    its lower bits, so the maximum becomes 0xFFFFFFFF.
+    static uint32_t scaleUp(uint32_t source, int sourceBits)
+    {
+        int scaleBits = 32 - sourceBits;
+        uint32_t shifted = source << scaleBits;
+        if (source <= (1u << (sourceBits - 1))) {
+            return shifted;
+        }
+        int repeatBits = sourceBits - 1;
+        uint32_t repeat = source & ((1u << repeatBits) - 1);
+        if (scaleBits > repeatBits) {
+            repeat <<= scaleBits - repeatBits;
+        } else {
+            repeat >>= repeatBits - scaleBits;
+        }
+        while (repeat != 0) {
+            shifted |= repeat;
+            repeat >>= repeatBits;
+        }
+        return shifted;
+    }
+
+//    A MIDI 1.0 channel message of up to three bytes.
+//    Note On with velocity 0 becomes a Note Off.
+    static MidiEvent fromBytes(uint8_t data0, uint8_t data1, uint8_t data2)
+    {
+        MidiEvent event;
+        event.status = data0 & 0xF0;
+        event.channel = data0 & 0x0F;
+        event.index = data1 & 0x7F;
+
+        switch (event.status) {
+            case 0x90:
+                if ((data2 & 0x7F) == 0) {
+                    event.status = 0x80;
+                }
+                event.value = scaleUp(data2 & 0x7F, 7);
+                break;
+            case 0x80:
+            case 0xA0:
+            case 0xB0:
+                event.value = scaleUp(data2 & 0x7F, 7);
+                break;
+            case 0xC0:
+                break;
+            case 0xD0:
+                event.index = 0;
+                event.value = scaleUp(data1 & 0x7F, 7);
+                break;
+            case 0xE0:
+                event.index = 0;
+                event.value = scaleUp(uint32_t(data1 & 0x7F) | (uint32_t(data2 & 0x7F) << 7), 14);
+                break;
+            default:
+                event.status = 0;
+                break;
+        }
+        return event;
+    }
+};
+
+//    Turns the MIDI 1.0 byte stream into events. It pairs Control
+//    Changes 0 - 31 with their LSB controllers 32 - 63, so a mod wheel
+//    that sends both moves in 16384 steps instead of 128.
+class MidiEventDecoder {
+public:
+    MidiEventDecoder() { reset(); }
+
+    void reset()
+    {
+        for (auto& channel : msb) {
+            for (auto& value : channel) {
+                value = -1;
+            }
+        }
+    }
+
+    MidiEvent decode(const uint8_t* data, int numBytes)
+    {
+        if (numBytes < 1 || numBytes > 3) {
+            return MidiEvent();
+        }
+        uint8_t data1 = (numBytes >= 2) ? data[1] : 0;
+        uint8_t data2 = (numBytes == 3) ? data[2] : 0;
+        MidiEvent event = MidiEvent::fromBytes(data[0], data1, data2);
+
+        if (event.status == 0xB0 && event.index < 64) {
+            int& stored = msb[event.channel][event.index & 31];
+            if (event.index < 32) {
+//                A new MSB always starts without an LSB.
+                stored = data2 & 0x7F;
+            } else if (stored >= 0) {
+//                The LSB refines the last MSB of its controller. An LSB
+//                without an MSB stays a controller of its own, so it can
+//                still be learned.
+                event.index -= 32;
+                event.value = MidiEvent::scaleUp(uint32_t(stored << 7) | (data2 & 0x7F), 14);
+            }
+        }
+        return event;
+    }
+
+private:
+//    Last MSB of controllers 0 - 31 per channel, or -1.
+    int msb[16][32];
+};
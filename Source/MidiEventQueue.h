@@ -0,0 +1,67 @@
+/*
+  ==============================================================================
+
+    MidiEventQueue.h
+    Created: 18 Oct 2026 7:05:24pm
+    Author:  MacJay
+
+    Carries MIDI events from the editor, such as the on-screen
+    keyboard, to the audio thread.
+
+    The editor is the only writer and the audio thread the only
+    reader, so a juce::AbstractFifo is enough, like in AudioScope.
+    Neither side ever locks or waits. The audio thread takes all
+    waiting events at the start of a block.
+
+    juce::MidiKeyboardState isn't used for this: its
+    processNextMidiBuffer() locks a critical section that the editor
+    holds while it handles a key, so the audio thread could end up
+    waiting for the message thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "MidiEvent.h"
+
+class MidiEventQueue
+{
+public:
+    static constexpr int capacity = 256;
+
+//    Editor side. Returns false if the queue is full, which only
+//    happens when the audio thread isn't running.
+    bool push(const MidiEvent& event)
+    {
+        const auto scope = fifo.write(1);
+        if (scope.blockSize1 > 0) {
+            events[size_t(scope.startIndex1)] = event;
+            return true;
+        }
+        if (scope.blockSize2 > 0) {
+            events[size_t(scope.startIndex2)] = event;
+            return true;
+        }
+        return false;
+    }
+
+//    Audio thread. Copies up to maxEvents events into destination
+//    and returns how many.
+    int pop(MidiEvent* destination, int maxEvents)
+    {
+        const auto scope = fifo.read(juce::jmin(maxEvents, fifo.getNumReady()));
+        for (int i = 0; i < scope.blockSize1; ++i) {
+            destination[i] = events[size_t(scope.startIndex1 + i)];
+        }
+        for (int i = 0; i < scope.blockSize2; ++i) {
+            destination[scope.blockSize1 + i] = events[size_t(scope.startIndex2 + i)];
+        }
+        return scope.blockSize1 + scope.blockSize2;
+    }
+
+private:
+    juce::AbstractFifo fifo {capacity};
+    std::array<MidiEvent, capacity> events;
+};
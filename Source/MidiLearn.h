@@ -0,0 +1,131 @@
+/*
+  ==============================================================================
+
+    MidiLearn.h
+    Created: 18 Oct 2026 6:40:12pm
+    Author:  MacJay
+
+    The MIDI learn table. Each of the 128 controllers can drive one
+    parameter over a part of its range, with a curve.
+
+    The message thread edits the table, the audio thread looks up
+    every incoming Control Change in it. There are two copies of the
+    table: the audio thread reads the front one for a whole block,
+    the message thread writes the other one and then swaps them.
+    The audio thread never waits; the message thread may, for at
+    most one block.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "RealtimeCheck.h"
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+struct MidiMapping {
+    enum Curve : uint8_t {
+        linear,
+//        Finer control at the low end.
+        exponential,
+//        Finer control at the high end.
+        logarithmic,
+    };
+
+//    Index in the order of Preset::param, -1 if the controller
+//    isn't mapped.
+    int param = -1;
+
+//    Part of the parameter's range the controller sweeps, as
+//    normalised 0 - 1 values. min > max turns the controller around.
+    float min = 0.0f;
+    float max = 1.0f;
+    uint8_t curve = linear;
+
+//    Turns the controller position (0 - 1) into the normalised
+//    parameter value.
+    float apply(float position) const
+    {
+        float shaped = position;
+        if (curve == exponential) {
+            shaped = position * position;
+        } else if (curve == logarithmic) {
+            shaped = std::sqrt(position);
+        }
+        return min + (max - min) * shaped;
+    }
+};
+
+class MidiLearnMap {
+public:
+    static constexpr int NUM_CC = 128;
+    using Table = std::array<MidiMapping, NUM_CC>;
+
+//    A copy of the current table. Not for the audio thread.
+    Table get() const
+    {
+        JX11_ASSERT_NOT_REALTIME("MidiLearnMap::get()");
+        const RealtimeCheck::CriticalSection::ScopedLockType lock(writeLock);
+        return tables[front.load()];
+    }
+
+//    Replaces the whole table. Not for the audio thread.
+    void set(const Table& table)
+    {
+        JX11_ASSERT_NOT_REALTIME("MidiLearnMap::set()");
+        const RealtimeCheck::CriticalSection::ScopedLockType lock(writeLock);
+        int back = 1 - front.load();
+
+//        The audio thread may still be reading the table it had
+//        before the last swap. It lets go at the end of its block.
+        while (reading.load() == back) {
+            juce::Thread::yield();
+        }
+        tables[back] = table;
+        front.store(back);
+    }
+
+//    Maps controller cc to a parameter over its full range. A
+//    parameter only has one controller, an older one is removed.
+    void learn(int cc, int param)
+    {
+        const RealtimeCheck::CriticalSection::ScopedLockType lock(writeLock);
+        Table table = get();
+        for (auto& mapping : table) {
+            if (mapping.param == param) {
+                mapping = MidiMapping();
+            }
+        }
+        table[size_t(cc)] = MidiMapping();
+        table[size_t(cc)].param = param;
+        set(table);
+    }
+
+//    Audio thread: the table stays valid until release().
+    const Table& acquire()
+    {
+        int index;
+        do {
+            index = front.load();
+            reading.store(index);
+        } while (front.load() != index);
+        return tables[index];
+    }
+
+    void release()
+    {
+        reading.store(-1);
+    }
+
+private:
+    Table tables[2];
+    std::atomic<int> front {0};
+    std::atomic<int> reading {-1};
+
+//    Only between the threads that write.
+    RealtimeCheck::CriticalSection writeLock;
+};
@@ -0,0 +1,231 @@
+/*
+  ==============================================================================
+
+    OutputStage.cpp
+    Created: 18 Oct 2026 8:24:36pm
+    Author:  MacJay
+
+  ==============================================================================
+*/
+
+#include "OutputStage.h"
+
+namespace {
+//    The largest magnitude between x[1] and x[2], the samples included.
+//    A Catmull-Rom curve through the four samples stands in for the
+//    band-limited signal and is checked at three points in between.
+//    Not as exact as 4x oversampling with a long FIR, but it catches
+//    most of the overshoot for a fraction of the cost.
+    float truePeak(const float* x)
+    {
+        float a = x[0], b = x[1], c = x[2], d = x[3];
+        float peak = juce::jmax(std::abs(b), std::abs(c));
+
+        float c1 = 0.5f * (c - a);
+        float c2 = a - 2.5f * b + 2.0f * c - 0.5f * d;
+        float c3 = 0.5f * (d - a) + 1.5f * (b - c);
+        for (float t : { 0.25f, 0.5f, 0.75f }) {
+            float y = ((c3 * t + c2) * t + c1) * t + b;
+            peak = juce::jmax(peak, std::abs(y));
+        }
+        return peak;
+    }
+}
+
+void OutputStage::prepare(double sampleRate)
+{
+//    1.5 ms to bring the gain down before a peak.
+    lookahead = juce::jmax(1, juce::roundToInt(sampleRate * 0.0015));
+
+//    The peak between two samples is only known once the sample
+//    after them has arrived, which adds one more sample.
+    latency = lookahead + 1;
+
+//    Recovers with a time constant of 50 ms.
+    releaseCoeff = float(1.0 - std::exp(-1.0 / (0.05 * sampleRate)));
+
+    for (auto& channel : delay) {
+        channel.assign(size_t(latency), 0.0f);
+    }
+    minGains.assign(size_t(lookahead + 1), 1.0f);
+    minSteps.assign(size_t(lookahead + 1), 0);
+    averageRing.assign(size_t(lookahead), 1.0f);
+    reset();
+}
+
+void OutputStage::reset()
+{
+    for (auto& channel : delay) {
+        std::fill(channel.begin(), channel.end(), 0.0f);
+    }
+    delayPos = 0;
+    for (auto& channel : history) {
+        std::fill(std::begin(channel), std::end(channel), 0.0f);
+    }
+    releaseGain = 1.0f;
+    minHead = 0;
+    minCount = 0;
+    step = 0;
+    std::fill(averageRing.begin(), averageRing.end(), 1.0f);
+    averagePos = 0;
+    averageSum = double(averageRing.size());
+    quietSamples = latency;
+}
+
+OutputStage::Scan OutputStage::scan(const float* samples, int numSamples)
+{
+//    Without the sign bit, the bits of a float sort the same as
+//    its magnitude when they're read as an integer, and inf and nan
+//    are above everything else. So one integer maximum finds the
+//    peak and any nan or inf at the same time. The loop has no
+//    branches, so the compiler turns it into SIMD max instructions.
+    uint32_t maxBits = 0;
+    for (int i = 0; i < numSamples; ++i) {
+        uint32_t bits;
+        std::memcpy(&bits, samples + i, sizeof(bits));
+        bits &= 0x7FFFFFFFu;
+        maxBits = (bits > maxBits) ? bits : maxBits;
+    }
+
+    Scan result;
+    result.finite = maxBits < 0x7F800000u;
+    std::memcpy(&result.peak, &maxBits, sizeof(maxBits));
+    return result;
+}
+
+void OutputStage::process(float* left, float* right, int numSamples, bool limiting, RealtimeLog* log)
+{
+    if (left == nullptr || numSamples <= 0) {
+        return;
+    }
+
+    Scan scanLeft = scan(left, numSamples);
+    Scan scanRight = (right != nullptr) ? scan(right, numSamples) : scanLeft;
+    float peak = juce::jmax(scanLeft.peak, scanRight.peak);
+    if (!scanLeft.finite || !scanRight.finite) {
+        silence(left, right, numSamples, log);
+        peak = 0.0f;
+    }
+
+    bool wasSilent = isSilent(limiting);
+    quietSamples = (peak == 0.0f) ? juce::jmin(quietSamples + numSamples, latency) : 0;
+
+    if (limiting) {
+//        Nothing in the delay line and nothing coming in.
+        if (!(wasSilent && peak == 0.0f)) {
+            limit(left, right, numSamples);
+        }
+    } else if (peak > 1.0f) {
+        if (scanLeft.peak > 1.0f) {
+            clip(left, numSamples, log);
+        }
+        if (right != nullptr && scanRight.peak > 1.0f) {
+            clip(right, numSamples, log);
+        }
+    }
+}
+
+void OutputStage::silence(float* left, float* right, int numSamples, RealtimeLog* log)
+{
+//    Reports the first bad sample.
+    if (log != nullptr) {
+        bool found = false;
+        for (float* samples : { left, right }) {
+            for (int i = 0; samples != nullptr && i < numSamples && !found; ++i) {
+                if (!std::isfinite(samples[i])) {
+                    log->write(std::isnan(samples[i]) ? RealtimeLog::nanSilenced : RealtimeLog::infSilenced,
+                               i, samples[i]);
+                    found = true;
+                }
+            }
+        }
+    }
+
+    juce::FloatVectorOperations::clear(left, numSamples);
+    if (right != nullptr) {
+        juce::FloatVectorOperations::clear(right, numSamples);
+    }
+}
+
+void OutputStage::clip(float* samples, int numSamples, RealtimeLog* log)
+{
+    if (log != nullptr) {
+        for (int i = 0; i < numSamples; ++i) {
+            if (std::abs(samples[i]) > 1.0f) {
+                log->write(RealtimeLog::outOfRangeClamped, i, samples[i]);
+                break;
+            }
+        }
+    }
+    juce::FloatVectorOperations::clip(samples, samples, -1.0f, 1.0f, numSamples);
+}
+
+void OutputStage::limit(float* left, float* right, int numSamples)
+{
+    float* channels[2] = { left, right };
+    int numChannels = (right != nullptr) ? 2 : 1;
+    float inverseLookahead = 1.0f / float(lookahead);
+
+    for (int i = 0; i < numSamples; ++i) {
+//        Both channels get the same gain, so the stereo image stays.
+        float peak = 0.0f;
+        for (int ch = 0; ch < numChannels; ++ch) {
+            float* h = history[ch];
+            h[0] = h[1];
+            h[1] = h[2];
+            h[2] = h[3];
+            h[3] = channels[ch][i];
+            peak = juce::jmax(peak, truePeak(h));
+        }
+        float gain = (peak > ceiling) ? ceiling / peak : 1.0f;
+
+//        Down at once, up slowly.
+        if (gain < releaseGain) {
+            releaseGain = gain;
+        } else {
+            releaseGain += (gain - releaseGain) * releaseCoeff;
+        }
+
+//        Holding the minimum for `lookahead` steps and averaging over
+//        as many makes the gain reach its minimum exactly when the
+//        delayed peak comes out, and never later.
+        float held = holdMinimum(releaseGain);
+        averageSum += double(held - averageRing[size_t(averagePos)]);
+        averageRing[size_t(averagePos)] = held;
+        averagePos = (averagePos + 1) % lookahead;
+        float smoothGain = juce::jmin(1.0f, float(averageSum) * inverseLookahead);
+
+        for (int ch = 0; ch < numChannels; ++ch) {
+            float input = channels[ch][i];
+            channels[ch][i] = delay[ch][size_t(delayPos)] * smoothGain;
+            delay[ch][size_t(delayPos)] = input;
+        }
+        delayPos = (delayPos + 1) % latency;
+    }
+}
+
+float OutputStage::holdMinimum(float gain)
+{
+    int capacity = int(minGains.size());
+
+//    Older entries that aren't smaller can never be the minimum again.
+    while (minCount > 0) {
+        int back = (minHead + minCount - 1) % capacity;
+        if (minGains[size_t(back)] < gain) {
+            break;
+        }
+        --minCount;
+    }
+    int back = (minHead + minCount) % capacity;
+    minGains[size_t(back)] = gain;
+    minSteps[size_t(back)] = step;
+    ++minCount;
+
+//    The front drops out once it's `lookahead` steps old.
+    while (step - minSteps[size_t(minHead)] >= uint32_t(lookahead)) {
+        minHead = (minHead + 1) % capacity;
+        --minCount;
+    }
+    ++step;
+    return minGains[size_t(minHead)];
+}
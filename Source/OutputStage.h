@@ -0,0 +1,98 @@
+/*
+  ==============================================================================
+
+    OutputStage.h
+    Created: 18 Oct 2026 8:24:36pm
+    Author:  MacJay
+
+    Ear protection for one output bus, the last thing in processBlock().
+
+    Every block is first scanned for nan, inf and the peak in a single
+    pass (see scan()). Usually that's all that happens. Only if the
+    scan finds something does the expensive part run:
+
+    - nan or inf: the block is muted, since the filters that made
+      it won't recover within the block anyway.
+    - Without the limiter, samples beyond ±1 are clipped.
+    - With the limiter, every block goes through a lookahead limiter
+      that keeps the true peak, the peak between the samples too,
+      below -1 dB. The gain starts coming down before the peak arrives
+      instead of clipping it, so it doesn't crackle. The price is a
+      latency of about 1.5 ms, which the processor reports to the host.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "RealtimeLog.h"
+
+class OutputStage
+{
+public:
+//    -1 dBTP, so converters and codecs later on don't clip either.
+    static constexpr float ceiling = 0.891251f;
+
+//    Allocates the delay line for this sample rate.
+    void prepare(double sampleRate);
+    void reset();
+
+//    Samples the limiter delays the output by.
+    int getLatency() const { return latency; }
+
+//    Audio thread. right is nullptr for a mono bus.
+    void process(float* left, float* right, int numSamples, bool limit, RealtimeLog* log);
+
+//    True if the delay line has run empty, so a silent
+//    block doesn't need to go through the limiter.
+    bool isSilent(bool limit) const { return !limit || quietSamples >= latency; }
+
+    struct Scan {
+        bool finite;
+        float peak;
+    };
+
+//    The largest magnitude in the block and whether all samples are
+//    finite. Vectorized, no branches per sample.
+    static Scan scan(const float* samples, int numSamples);
+
+private:
+//    The expensive paths.
+    void silence(float* left, float* right, int numSamples, RealtimeLog* log);
+    void clip(float* samples, int numSamples, RealtimeLog* log);
+    void limit(float* left, float* right, int numSamples);
+
+//    Smallest gain of the last `lookahead` steps, as a monotonic queue.
+    float holdMinimum(float gain);
+
+    int lookahead = 1;
+    int latency = 0;
+    float releaseCoeff = 0.0f;
+
+//    Delayed input, one ring per channel.
+    std::vector<float> delay[2];
+    int delayPos = 0;
+
+//    The last four input samples of each channel, for the
+//    interpolation between them.
+    float history[2][4] {};
+
+//    Gain after the release, before the hold.
+    float releaseGain = 1.0f;
+
+//    Queue of (gain, step) for holdMinimum().
+    std::vector<float> minGains;
+    std::vector<uint32_t> minSteps;
+    int minHead = 0;
+    int minCount = 0;
+    uint32_t step = 0;
+
+//    Moving average over the held gain, so the gain
+//    ramps down in `lookahead` steps instead of jumping.
+    std::vector<float> averageRing;
+    int averagePos = 0;
+    double averageSum = 0.0;
+
+    int quietSamples = 0;
+};
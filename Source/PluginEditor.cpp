@@ -43,6 +43,7 @@ JX11AudioProcessorEditor::JX11AudioProcessorEditor (JX11AudioProcessor& p)
     noiseKnob.label = "Noise";
     octaveKnob.label = "Octave";
     tuningKnob.label = "Tuning";
+    morphKnob.label = "A / B";
     
 //    Setting the suffix for each knob.
     outputLevelKnob.setTextValueSuffix(" dB");
@@ -70,6 +71,7 @@ JX11AudioProcessorEditor::JX11AudioProcessorEditor (JX11AudioProcessor& p)
     noiseKnob.setTextValueSuffix(" %");
     octaveKnob.setTextValueSuffix(" octave");
     tuningKnob.setTextValueSuffix(" cent");
+    morphKnob.setTextValueSuffix(" %");
     
 //    Set tooltips for each knob.
     outputLevelKnob.setTooltip("Adjust the output level in dB.");
@@ -97,16 +99,48 @@ JX11AudioProcessorEditor::JX11AudioProcessorEditor (JX11AudioProcessor& p)
     noiseKnob.setTooltip("Adjust the noise level in percentage.");
     octaveKnob.setTooltip("Select the oscillator octave.");
     tuningKnob.setTooltip("Adjust the tuning in cents.");
+    morphKnob.setTooltip("Blend between the sounds stored in A and B.");
+    morphAButton.setTooltip("Store the current sound as morph start point A.");
+    morphBButton.setTooltip("Store the current sound as morph end point B.");
     polyModeButton.setTooltip("Toggle between mono and polyphonic modes.");
-    midiLearnButton.setTooltip("Enable MIDI Learn mode.");
+    multiTimbralButton.setTooltip("Play a separate part on each of MIDI channels 2 to 16.");
+    mpeButton.setTooltip("MPE: per-note pitch bend, pressure and timbre on channels 2 to 16.");
+    midiLearnButton.setTooltip("MIDI Learn: move a knob, then the controller that should drive it.");
+    openGLButton.setTooltip("Draw the editor with OpenGL.");
+    limiterButton.setTooltip("Limit the output to -1 dB true peak. Adds 1.5 ms latency.");
     presetSelector.setTooltip("Select predefinded programs.");
+    presetSearch.setTooltip("Search the user presets, or type a name and press Save. Words with a # in front become tags.");
+    savePresetButton.setTooltip("Save the current sound as a user preset.");
 
     
     polyModeButton.setButtonText(isPolyMode ? "Mono" : "Poly");
     polyModeButton.setClickingTogglesState(true);
     polyModeButton.addListener(this);
+    multiTimbralButton.setButtonText("Multi");
+    multiTimbralButton.setClickingTogglesState(true);
+    multiTimbralButton.setToggleState(audioProcessor.multiTimbral, juce::dontSendNotification);
+    multiTimbralButton.addListener(this);
+    mpeButton.setButtonText("MPE");
+    mpeButton.setClickingTogglesState(true);
+    mpeButton.setToggleState(audioProcessor.mpe, juce::dontSendNotification);
+    mpeButton.addListener(this);
+    limiterButton.setButtonText("Limit");
+    limiterButton.setClickingTogglesState(true);
+    limiterButton.setToggleState(audioProcessor.limiterEnabled, juce::dontSendNotification);
+    limiterButton.addListener(this);
     midiLearnButton.setButtonText("Midi");
     midiLearnButton.addListener(this);
+    openGLButton.setButtonText("GPU");
+    openGLButton.setClickingTogglesState(true);
+    openGLButton.addListener(this);
+    morphAButton.setButtonText("A");
+    morphAButton.addListener(this);
+    morphBButton.setButtonText("B");
+    morphBButton.addListener(this);
+    savePresetButton.setButtonText("Save");
+    savePresetButton.addListener(this);
+    presetSearch.setTextToShowWhenEmpty("Search...", juce::Colours::grey);
+    presetSearch.addListener(this);
     
 //      Add components to the contentComponent.
     contentComponent->addAndMakeVisible(oscMixKnob);
@@ -118,9 +152,13 @@ JX11AudioProcessorEditor::JX11AudioProcessorEditor (JX11AudioProcessor& p)
     contentComponent->addAndMakeVisible(filterLFOKnob);
     contentComponent->addAndMakeVisible(filterVelocityKnob);
     contentComponent->addAndMakeVisible(polyModeButton);
+    contentComponent->addAndMakeVisible(multiTimbralButton);
+    contentComponent->addAndMakeVisible(mpeButton);
     contentComponent->addAndMakeVisible(midiLearnButton);
+    contentComponent->addAndMakeVisible(openGLButton);
     contentComponent->addAndMakeVisible(presetSelector);
     contentComponent->addAndMakeVisible(outputLevelKnob);
+    contentComponent->addAndMakeVisible(limiterButton);
     contentComponent->addAndMakeVisible(filterAttackKnob);
     contentComponent->addAndMakeVisible(filterDecayKnob);
     contentComponent->addAndMakeVisible(filterSustainKnob);
@@ -138,6 +176,9 @@ JX11AudioProcessorEditor::JX11AudioProcessorEditor (JX11AudioProcessor& p)
     contentComponent->addAndMakeVisible(glideRateKnob);
     contentComponent->addAndMakeVisible(glideBendKnob);
     contentComponent->addAndMakeVisible(glideModeKnob);
+    contentComponent->addAndMakeVisible(morphKnob);
+    contentComponent->addAndMakeVisible(morphAButton);
+    contentComponent->addAndMakeVisible(morphBButton);
     
 //    Initialize and add the labels.
     configureLabel(oscillatorLabel, "Oscillator",
@@ -158,6 +199,8 @@ JX11AudioProcessorEditor::JX11AudioProcessorEditor (JX11AudioProcessor& p)
                    juce::Justification::centredLeft, 15.0f, juce::Font::bold);
     configureLabel(outLabel, "Master",
                    juce::Justification::centredTop, 15.0f, juce::Font::bold);
+    configureLabel(morphLabel, "Morph",
+                   juce::Justification::centredTop, 15.0f, juce::Font::bold);
     
 //      Add labels to the contentComponent.
     contentComponent->addAndMakeVisible(oscillatorLabel);
@@ -167,39 +210,58 @@ JX11AudioProcessorEditor::JX11AudioProcessorEditor (JX11AudioProcessor& p)
     contentComponent->addAndMakeVisible(envLabel);
     contentComponent->addAndMakeVisible(modLabel);
     contentComponent->addAndMakeVisible(outLabel);
+    contentComponent->addAndMakeVisible(morphLabel);
     contentComponent->addAndMakeVisible(fenvLabel);
     contentComponent->addAndMakeVisible(presetSelector);
+    contentComponent->addAndMakeVisible(presetSearch);
+    contentComponent->addAndMakeVisible(savePresetButton);
     contentComponent->addAndMakeVisible(midiLabel);
 
-//    Fetch preset names from audioProcessor as
-//    std::vector<std::string>
-    std::vector<std::string> presetNames = audioProcessor.getPresetNames();
-//    Convert std::vector<std::string> to StringArray
-    juce::StringArray presetNamesArray;
-    for (const auto& name : presetNames) {
-        presetNamesArray.add(name);
-    }
-
-//    Use StringArray with addItemList() in your GUI
-//    component (presetSelector)
-    presetSelector.addItemList(presetNamesArray, 1);
+//    The list of presets is only built when it pops up.
+//    Until then the selector just shows the current program.
+    presetSelector.setText(audioProcessor.getProgramName(audioProcessor.getCurrentProgram()),
+                           juce::dontSendNotification);
+    presetSelector.onShowPopup = [this] { updateUserPresetList(); };
 //    Register presetSelector as a listener
     presetSelector.addListener(this);
+    audioProcessor.getUserPresets().addChangeListener(this);
     
 //    Add the contentComponent to the viewport
     viewPort.setViewedComponent(contentComponent.get(), true);
+    viewPort.onVisibleAreaChanged = [this](juce::Rectangle<int> visibleArea) {
+        createVisibleSections(visibleArea);
+    };
     addAndMakeVisible(viewPort);
 
+    keyboardState.addListener(this);
+    
 //    Set the size of the main editor.
     setSize (550, 600);
+    
+    setOpenGLEnabled(audioProcessor.useOpenGL);
 }
 
 JX11AudioProcessorEditor::~JX11AudioProcessorEditor()
 {
+   #if JUCE_MODULE_AVAILABLE_juce_opengl
+    openGLContext.detach();
+   #endif
     juce::LookAndFeel::setDefaultLookAndFeel(nullptr);
     polyModeButton.removeListener(this); 
+    multiTimbralButton.removeListener(this);
+    mpeButton.removeListener(this);
+    limiterButton.removeListener(this);
     midiLearnButton.removeListener(this);
+    openGLButton.removeListener(this);
+    savePresetButton.removeListener(this);
+    morphAButton.removeListener(this);
+    morphBButton.removeListener(this);
+    audioProcessor.getUserPresets().removeChangeListener(this);
     audioProcessor.midiLearn = false;
+    
+//    Keys that are still held down would never get a Note Off.
+    keyboardState.allNotesOff(0);
+    keyboardState.removeListener(this);
 }
 
 //==============================================================================
@@ -212,7 +274,6 @@ void JX11AudioProcessorEditor::paint (juce::Graphics& g)
 void JX11AudioProcessorEditor::resized()
 
 {
-    DBG("Resized called");
 //      Define margins and spacing
     const int margin = 10;
     const int labelHeight = 20;
@@ -230,7 +291,7 @@ void JX11AudioProcessorEditor::resized()
     
 //    Set the size of the content component to be
 //    larger than the viewport to enable scrolling.
-    contentComponent->setSize(600, 800);
+    contentComponent->setSize(600, 1320);
     
 //       Create a working area within the editor window with margins
    auto bounds = contentComponent->getLocalBounds().reduced(margin);
@@ -281,12 +342,30 @@ void JX11AudioProcessorEditor::resized()
                     envReleaseKnob.getWidth(), envReleaseKnob.getHeight() + labelHeight);
     outLabel.setBounds(outArea.removeFromTop(labelHeight));
     outputLevelKnob.setBounds(outArea);
+    limiterButton.setBounds(outputLevelKnob.getX() + (outputLevelKnob.getWidth() - buttonWidth) / 2,
+                            outputLevelKnob.getBottom() + spacing, buttonWidth, buttonHeight);
+    
+//    Morph, in the same column one section higher.
+    morphArea = juce::Rectangle<int>(outputLevelKnobX, filterReleaseKnob.getY() - labelHeight,
+                    filterReleaseKnob.getWidth(), filterReleaseKnob.getHeight() + labelHeight);
+    morphLabel.setBounds(morphArea.removeFromTop(labelHeight));
+    morphKnob.setBounds(morphArea);
+    
+//    The A and B buttons above it, in the filter section.
+    int morphButtonY = filterVelocityKnob.getY() + filterVelocityKnob.getHeight() / 2;
+    morphAButton.setBounds(morphLabel.getX(), morphButtonY, buttonWidth / 2, buttonHeight);
+    morphBButton.setBounds(morphAButton.getRight() + spacing, morphButtonY,
+                           buttonWidth / 2, buttonHeight);
     
 //    Polyphony
     polyLabel.setBounds(glideModeKnob.getX(), glideModeKnob.getBottom() + spacing,
                         knobWidth, labelHeight);
     polyModeButton.setBounds(polyLabel.getX(), polyLabel.getBottom() + spacing,
                              buttonWidth, buttonHeight);
+    multiTimbralButton.setBounds(polyModeButton.getRight() + spacing, polyModeButton.getY(),
+                                 buttonWidth, buttonHeight);
+    mpeButton.setBounds(multiTimbralButton.getRight() + spacing, polyModeButton.getY(),
+                        buttonWidth, buttonHeight);
 
 //    Presets
     int polyLabelX = polyLabel.getRight() - (3 * spacing) +
@@ -296,12 +375,87 @@ void JX11AudioProcessorEditor::resized()
     presetLabel.setBounds(polyLabelX, polyLabelY, knobWidth, labelHeight);
     presetSelector.setBounds(presetLabel.getX(), presetLabel.getBottom() + spacing,
                              presetWidth, presetHeight);
+    presetSearch.setBounds(presetSelector.getX(), presetSelector.getBottom() + spacing,
+                           presetWidth, presetHeight);
+    savePresetButton.setBounds(presetSearch.getX(), presetSearch.getBottom() + spacing,
+                               buttonWidth, buttonHeight);
+    
+//    Scope below everything else, across the full width.
+    scopeArea = juce::Rectangle<int>(margin, savePresetButton.getBottom() + 2 * spacing,
+                                     contentComponent->getWidth() - 2 * margin, 160);
+    voiceArea = juce::Rectangle<int>(margin, scopeArea.getBottom() + spacing,
+                                     contentComponent->getWidth() - 2 * margin, 170);
+    if (scopeView != nullptr) {
+        scopeView->setBounds(scopeArea);
+    }
+    keyboardArea = juce::Rectangle<int>(margin, voiceArea.getBottom() + spacing,
+                                        contentComponent->getWidth() - 2 * margin, 80);
+    if (voiceView != nullptr) {
+        voiceView->setBounds(voiceArea);
+    }
+    if (keyboard != nullptr) {
+        keyboard->setBounds(keyboardArea);
+    }
     
 //    Midi learn
     midiLabel.setBounds(vibratoKnob.getX(), vibratoKnob.getBottom() + spacing,
                         knobWidth, labelHeight);
     midiLearnButton.setBounds(midiLabel.getX(), midiLabel.getBottom() + spacing, buttonWidth, buttonHeight);
+    openGLButton.setBounds(midiLearnButton.getRight() + spacing, midiLearnButton.getY(),
+                           buttonWidth, buttonHeight);
+
+//    A bigger editor may already show the bottom panels.
+    createVisibleSections(viewPort.getViewArea());
+}
+
+void JX11AudioProcessorEditor::createVisibleSections(juce::Rectangle<int> visibleArea)
+{
+//    Once created, a panel stays until the editor closes.
+    if (scopeView == nullptr && visibleArea.intersects(scopeArea)) {
+        scopeView = std::make_unique<ScopeView>(audioProcessor.getScope());
+        scopeView->setBounds(scopeArea);
+        contentComponent->addAndMakeVisible(*scopeView);
+    }
+    if (voiceView == nullptr && visibleArea.intersects(voiceArea)) {
+        voiceView = std::make_unique<VoiceView>(audioProcessor.getVoiceMonitor());
+        voiceView->setBounds(voiceArea);
+        contentComponent->addAndMakeVisible(*voiceView);
+    }
+    if (keyboard == nullptr && visibleArea.intersects(keyboardArea)) {
+        keyboard = std::make_unique<juce::MidiKeyboardComponent>(
+                keyboardState, juce::MidiKeyboardComponent::horizontalKeyboard);
+        keyboard->setBounds(keyboardArea);
+        contentComponent->addAndMakeVisible(*keyboard);
+    }
+}
 
+void JX11AudioProcessorEditor::handleNoteOn(juce::MidiKeyboardState*, int midiChannel,
+                                            int midiNoteNumber, float velocity)
+{
+    sendNote(0x90, midiChannel, midiNoteNumber, velocity);
+}
+
+void JX11AudioProcessorEditor::handleNoteOff(juce::MidiKeyboardState*, int midiChannel,
+                                             int midiNoteNumber, float velocity)
+{
+    sendNote(0x80, midiChannel, midiNoteNumber, velocity);
+}
+
+void JX11AudioProcessorEditor::sendNote(int status, int midiChannel, int midiNoteNumber, float velocity)
+{
+    MidiEvent event;
+    event.status = uint8_t(status);
+    event.channel = uint8_t(juce::jlimit(1, 16, midiChannel) - 1);
+    event.index = uint8_t(midiNoteNumber & 0x7F);
+    event.value = MidiEvent::fromUnipolar(velocity);
+    
+//    Like a Note On with velocity 0 from a MIDI cable.
+    if (status == 0x90 && event.value == 0) {
+        event.status = 0x80;
+    }
+    
+//    Only fails while the host doesn't process audio.
+    audioProcessor.getEditorMidi().push(event);
 }
 
 //Helper Functions
@@ -359,7 +513,7 @@ void JX11AudioProcessorEditor::buttonClicked(juce::Button* button)
 //        So it can’t click it more than once.
         button->setButtonText("Waiting...");
         button->setEnabled(false);
-        audioProcessor.midiLearn = true;
+        audioProcessor.startMidiLearn();
         
 //        The timer will start running and call
 //        the timerCallback function ten times
@@ -368,6 +522,116 @@ void JX11AudioProcessorEditor::buttonClicked(juce::Button* button)
 //        approach to any UI component.
         startTimerHz(10);
     }
+    
+    if (button == &multiTimbralButton) {
+        audioProcessor.multiTimbral = multiTimbralButton.getToggleState();
+    }
+    
+    if (button == &mpeButton) {
+        audioProcessor.mpe = mpeButton.getToggleState();
+    }
+    
+    if (button == &limiterButton) {
+        audioProcessor.setLimiterEnabled(limiterButton.getToggleState());
+    }
+    
+    if (button == &openGLButton) {
+        setOpenGLEnabled(openGLButton.getToggleState());
+    }
+    
+    if (button == &morphAButton) {
+        audioProcessor.setMorphTarget(0);
+    }
+    
+    if (button == &morphBButton) {
+        audioProcessor.setMorphTarget(1);
+    }
+    
+    if (button == &savePresetButton) {
+//        "Warm Pad #pad #slow" saves "Warm Pad" with two tags.
+        juce::StringArray words;
+        words.addTokens(presetSearch.getText(), " ", "");
+        juce::StringArray nameWords, tags;
+        for (const auto& word : words) {
+            if (word.startsWithChar('#')) {
+                if (word.length() > 1) {
+                    tags.addIfNotAlreadyThere(word.substring(1));
+                }
+            } else if (word.isNotEmpty()) {
+                nameWords.add(word);
+            }
+        }
+        juce::String name = nameWords.joinIntoString(" ");
+        if (name.isEmpty()) {
+            name = "User Preset";
+        }
+        audioProcessor.saveUserPreset(name, tags);
+    }
+}
+
+void JX11AudioProcessorEditor::setOpenGLEnabled(bool enabled)
+{
+   #if JUCE_MODULE_AVAILABLE_juce_opengl
+    if (enabled) {
+//        The editor's components are still painted by JUCE,
+//        OpenGL only composites them.
+        openGLContext.setComponentPaintingEnabled(true);
+        openGLContext.attachTo(*this);
+        
+//        If the editor is on screen, the native context has just been
+//        created, or not. Otherwise this happens once it's shown.
+        checkOpenGL();
+    } else {
+        openGLContext.detach();
+    }
+   #else
+//    Built without juce_opengl: software rendering only.
+    enabled = false;
+    openGLButton.setEnabled(false);
+    openGLButton.setTooltip("OpenGL is not available in this build.");
+   #endif
+    
+    audioProcessor.useOpenGL = enabled;
+    openGLButton.setToggleState(enabled, juce::dontSendNotification);
+}
+
+void JX11AudioProcessorEditor::checkOpenGL()
+{
+   #if JUCE_MODULE_AVAILABLE_juce_opengl
+//    The context attaches itself as soon as the editor is showing with
+//    a size. isAttached() is only true if that made a native context.
+//    Without one (no GPU, no driver, headless machine) nothing would
+//    be drawn, so the editor goes back to software.
+    if (audioProcessor.useOpenGL && isShowing() && !getBounds().isEmpty()
+            && !openGLContext.isAttached()) {
+        setOpenGLEnabled(false);
+        openGLButton.setTooltip("OpenGL is not available on this system.");
+    }
+   #endif
+}
+
+void JX11AudioProcessorEditor::visibilityChanged()
+{
+    checkOpenGLLater();
+}
+
+void JX11AudioProcessorEditor::parentHierarchyChanged()
+{
+    checkOpenGLLater();
+}
+
+void JX11AudioProcessorEditor::checkOpenGLLater()
+{
+//    The context attaches itself in its own listener callback,
+//    which runs after this one. The check has to wait for it.
+    if (audioProcessor.useOpenGL) {
+        juce::Component::SafePointer<JX11AudioProcessorEditor> editor(this);
+        juce::MessageManager::callAsync([editor] {
+            if (editor != nullptr) {
+                editor->checkOpenGL();
+            }
+        });
+    }
 }
 
 void JX11AudioProcessorEditor::timerCallback()
@@ -385,12 +649,87 @@ void JX11AudioProcessorEditor::timerCallback()
 void JX11AudioProcessorEditor::comboBoxChanged(juce::ComboBox* comboBoxThatHasChanged)
 {
     if (comboBoxThatHasChanged == &presetSelector) {
-//        Getting the index of the selected preset.
-        int selectedPresetIndex = presetSelector.getSelectedItemIndex();
-        if (selectedPresetIndex >= 0) {
+//        The item ID tells which kind of preset was selected.
+        int selectedId = presetSelector.getSelectedId();
+        if (selectedId == morePresetsId) {
+//            Shows the next page of user presets.
+            userPresetPage += 1;
+            presetSelector.showPopup();
+        } else if (selectedId == previousPresetsId) {
+            userPresetPage = juce::jmax(0, userPresetPage - 1);
+            presetSelector.showPopup();
+        } else if (selectedId >= userPresetOffset) {
+            audioProcessor.loadUserPreset(selectedId - userPresetOffset);
+        } else if (selectedId > 0) {
 //            Let the audioprocessor set the appropiate setting.
-            applyPreset(selectedPresetIndex);
+            applyPreset(selectedId - 1);
+        }
+    }
+}
+
+void JX11AudioProcessorEditor::textEditorTextChanged(juce::TextEditor& editor)
+{
+//    The list itself is rebuilt when it pops up.
+    if (&editor == &presetSearch) {
+        userPresetPage = 0;
+    }
+}
+
+void JX11AudioProcessorEditor::changeListenerCallback(juce::ChangeBroadcaster*)
+{
+//    Record numbers changed, only matters if the list is open.
+    if (presetSelector.isPopupActive()) {
+        presetSelector.hidePopup();
+    }
+}
+
+void JX11AudioProcessorEditor::updateUserPresetList()
+{
+    PresetLibrary& library = audioProcessor.getUserPresets();
+    
+//    One extra result tells whether there is another page.
+//    A tag can be searched for with or without its #.
+    juce::Array<int> records = library.search(presetSearch.getText().trim().trimCharactersAtStart("#"),
+                                              userPresetPage * userPresetsPerPage,
+                                              userPresetsPerPage + 1);
+    
+//    Rebuilding the whole list is cheap, it only has
+//    NUM_PRESETS + userPresetsPerPage items at most.
+    int selectedId = presetSelector.getSelectedId();
+    juce::String shownText = presetSelector.getText();
+    presetSelector.clear(juce::dontSendNotification);
+    
+//    Fetch preset names from audioProcessor as
+//    std::vector<std::string>
+    std::vector<std::string> presetNames = audioProcessor.getPresetNames();
+//    Convert std::vector<std::string> to StringArray
+    juce::StringArray presetNamesArray;
+    for (const auto& name : presetNames) {
+        presetNamesArray.add(name);
+    }
+//    The item IDs of the factory presets start at 1.
+    presetSelector.addItemList(presetNamesArray, 1);
+    
+    if (!records.isEmpty() || userPresetPage > 0) {
+        presetSelector.addSectionHeading("User");
+        if (userPresetPage > 0) {
+            presetSelector.addItem("Previous...", previousPresetsId);
+        }
+        for (int i = 0; i < juce::jmin(records.size(), userPresetsPerPage); ++i) {
+            presetSelector.addItem(library.getPresetName(records[i]),
+                                   userPresetOffset + records[i]);
         }
+        if (records.size() > userPresetsPerPage) {
+            presetSelector.addItem("More...", morePresetsId);
+        }
+    }
+    
+    bool pageItem = (selectedId == morePresetsId || selectedId == previousPresetsId);
+    if (!pageItem && presetSelector.indexOfItemId(selectedId) >= 0) {
+        presetSelector.setSelectedId(selectedId, juce::dontSendNotification);
+    } else if (!pageItem) {
+//        Keeps the name shown before the list was built.
+        presetSelector.setText(shownText, juce::dontSendNotification);
     }
 }
 
@@ -12,6 +12,10 @@
 #include "PluginProcessor.h"
 #include "RotaryKnob.h"
 #include "LookAndFeel.h"
+#include "KnobAttachment.h"
+#include "ScopeView.h"
+#include "VoiceView.h"
+#include "EditorSections.h"
 #include "Preset.h"
 
 //==============================================================================
@@ -20,6 +24,9 @@
 class JX11AudioProcessorEditor : public juce::AudioProcessorEditor,
                                  public juce::Button::Listener,
                                  public juce::ComboBox::Listener,
+                                 public juce::TextEditor::Listener,
+                                 public juce::ChangeListener,
+                                 public juce::MidiKeyboardState::Listener,
                                  public juce::Timer
 {
 public:
@@ -31,6 +38,9 @@ public:
     void paint (juce::Graphics&) override;
 //    Doing the layout of those contents.
     void resized() override;
+//    The OpenGL context can only be checked once the editor is shown.
+    void visibilityChanged() override;
+    void parentHierarchyChanged() override;
     
 //    Toggles the button text when pressed.
     void buttonClicked(juce::Button* button) override;
@@ -42,17 +52,47 @@ public:
 //    This method will retrieve the preset data from the audio processor
 //    and apply it to the sliders.
     void applyPreset(int presetIndex);
+    
+//    Searches the user presets while typing.
+    void textEditorTextChanged(juce::TextEditor& editor) override;
+    
+//    The user bank was compacted and its record numbers changed.
+    void changeListenerCallback(juce::ChangeBroadcaster* source) override;
+    
+//    Sends the notes of the on-screen keyboard to the processor.
+    void handleNoteOn(juce::MidiKeyboardState*, int midiChannel, int midiNoteNumber, float velocity) override;
+    void handleNoteOff(juce::MidiKeyboardState*, int midiChannel, int midiNoteNumber, float velocity) override;
 
 private:
     
     JX11AudioProcessor& audioProcessor;
     
-    juce::ComboBox presetSelector;
+    PresetSelector presetSelector;
+    
+//    Filters the user presets in presetSelector. The text is
+//    also used as the name when the current sound is saved.
+    juce::TextEditor presetSearch;
+    juce::TextButton savePresetButton;
+    
+//    Item IDs in presetSelector: the factory presets start at 1,
+//    the user presets at userPresetOffset + record number.
+    static constexpr int userPresetOffset = 10000;
+    static constexpr int morePresetsId = userPresetOffset - 1;
+    static constexpr int previousPresetsId = userPresetOffset - 2;
+    
+//    Only one page of user presets is put into the list, so
+//    a bank with thousands of presets doesn't slow down the editor.
+    static constexpr int userPresetsPerPage = 100;
+    int userPresetPage = 0;
+    
+//    Fills presetSelector from the current search text and page.
+//    Called each time the list pops up, not while typing.
+    void updateUserPresetList();
     
     juce::TooltipWindow tooltip;
 
 //    Creates a scrollable area for the component.
-    juce::Viewport viewPort;
+    SectionViewport viewPort;
 //    Content component that will be scrolled.
 //    The contentComponent holds all the UI elements
 //    and is displayed inside the viewPort.
@@ -89,14 +129,40 @@ private:
     RotaryKnob noiseKnob;
     RotaryKnob octaveKnob;
     RotaryKnob tuningKnob;
+    RotaryKnob morphKnob;
+    
+//    Store the current sound as end point A or B of the morph.
+    juce::TextButton morphAButton;
+    juce::TextButton morphBButton;
 
+//    Turns the output limiter on and off.
+    juce::TextButton limiterButton;
+    
 //    MIDI Learn button.
 //    If pressed, it will set midiLearn to true and the
 //    audio processor will start scanning for a MIDI CC event.
     juce::TextButton midiLearnButton;
     
+//    Opt-in GPU compositing. JUCE paints the components as usual,
+//    but the result is composited with OpenGL instead of the
+//    software renderer. Without the juce_opengl module, or when no
+//    OpenGL context can be created, the editor stays in software.
+    juce::TextButton openGLButton;
+   #if JUCE_MODULE_AVAILABLE_juce_opengl
+    juce::OpenGLContext openGLContext;
+   #endif
+    void setOpenGLEnabled(bool enabled);
+//    Goes back to software if OpenGL was turned on but
+//    no native context could be created.
+    void checkOpenGL();
+    void checkOpenGLLater();
+    
 //    Toggle buttons between Poly and Mono mode
     juce::TextButton polyModeButton;
+//    Multi-timbral mode: a separate part per MIDI channel.
+    juce::TextButton multiTimbralButton;
+//    MPE controllers: a note per MIDI channel.
+    juce::TextButton mpeButton;
 //    Track the text mode.
        bool isPolyMode;
 //    Labels / Areas for aggregation of the knob types
@@ -118,87 +184,120 @@ private:
     juce::Rectangle<int> outArea;
     juce::Label outLabel;
     
+    juce::Rectangle<int> morphArea;
+    juce::Label morphLabel;
+    
     juce::Rectangle<int> polyArea;
     juce::Label polyLabel;
     
     juce::Label midiLabel;
     
     juce::Label presetLabel;
-//    Attachment object between a parameter from the APVTS and a slider/button.
+    
+//    Output scope and spectrum at the bottom.
+//    Both panels are below the fold when the editor opens, so they
+//    are created the first time their area is scrolled into view.
+    std::unique_ptr<ScopeView> scopeView;
+    juce::Rectangle<int> scopeArea;
+    
+//    What each voice is doing, below the scope.
+    std::unique_ptr<VoiceView> voiceView;
+    juce::Rectangle<int> voiceArea;
+    
+//    On-screen keyboard at the very bottom. Its state is only used on
+//    the message thread, the notes go to the processor through
+//    its MidiEventQueue.
+    juce::MidiKeyboardState keyboardState;
+    std::unique_ptr<juce::MidiKeyboardComponent> keyboard;
+    juce::Rectangle<int> keyboardArea;
+    void sendNote(int status, int midiChannel, int midiNoteNumber, float velocity);
+    
+    void createVisibleSections(juce::Rectangle<int> visibleArea);
+    
+//    Attachment object between a parameter from the APVTS and a button.
+//    The knobs use KnobAttachment instead.
     using APVTS = juce::AudioProcessorValueTreeState;
-    using SliderAttachment = APVTS::SliderAttachment;
     using ButtonAttachment = APVTS::ButtonAttachment;
     
+//    Moves the knobs to new parameter values in batches, 30 times
+//    per second, instead of on every single change. Declared before
+//    the attachments, so it outlives them.
+    KnobUpdateScheduler knobUpdates;
+    
 //    Constructing the attachment requires:
-//    1. A reference to the APVTS.
-//    2. ID for the parameter to look up the corresponding
+//    1. The scheduler for the knob updates.
+//    2. A reference to the APVTS.
+//    3. ID for the parameter to look up the corresponding
 //    AudioParameterFloat in the APVTS.
-//    3. Always expects a reference to the Slider object.
-    SliderAttachment outputLevelAttachment {audioProcessor.apvts, ParameterID::outputLevel.getParamID(), outputLevelKnob.slider};
+//    4. Always expects a reference to the Slider object.
+    KnobAttachment outputLevelAttachment { knobUpdates, audioProcessor.apvts, ParameterID::outputLevel.getParamID(), outputLevelKnob.slider};
     
-    SliderAttachment filterResoAttachment { audioProcessor.apvts, ParameterID::filterReso.getParamID(), filterResoKnob.slider };
+    KnobAttachment filterResoAttachment { knobUpdates, audioProcessor.apvts, ParameterID::filterReso.getParamID(), filterResoKnob.slider };
     
-    SliderAttachment filterFreqAttachment { audioProcessor.apvts, ParameterID::filterFreq.getParamID(), filterFreqKnob.slider };
+    KnobAttachment filterFreqAttachment { knobUpdates, audioProcessor.apvts, ParameterID::filterFreq.getParamID(), filterFreqKnob.slider };
     
-    SliderAttachment filterEnvAttachment { audioProcessor.apvts, ParameterID::filterEnv.getParamID(),
+    KnobAttachment filterEnvAttachment { knobUpdates, audioProcessor.apvts, ParameterID::filterEnv.getParamID(),
         filterEnvKnob.slider };
     
-    SliderAttachment filterLFOAttachment { audioProcessor.apvts, ParameterID::filterLFO.getParamID(),
+    KnobAttachment filterLFOAttachment { knobUpdates, audioProcessor.apvts, ParameterID::filterLFO.getParamID(),
         filterLFOKnob.slider };
     
-    SliderAttachment filterVelocityAttachment { audioProcessor.apvts, ParameterID::filterVelocity.getParamID(), filterVelocityKnob.slider };
+    KnobAttachment filterVelocityAttachment { knobUpdates, audioProcessor.apvts, ParameterID::filterVelocity.getParamID(), filterVelocityKnob.slider };
     
-    SliderAttachment filterAttackAttachment { audioProcessor.apvts,
+    KnobAttachment filterAttackAttachment { knobUpdates, audioProcessor.apvts,
         ParameterID::filterAttack.getParamID(), filterAttackKnob.slider };
     
-    SliderAttachment filterDecayAttachment { audioProcessor.apvts, ParameterID::filterDecay.getParamID(), filterDecayKnob.slider };
+    KnobAttachment filterDecayAttachment { knobUpdates, audioProcessor.apvts, ParameterID::filterDecay.getParamID(), filterDecayKnob.slider };
     
-    SliderAttachment filterSustainAttachment { audioProcessor.apvts, ParameterID::filterSustain.getParamID(), filterSustainKnob.slider };
+    KnobAttachment filterSustainAttachment { knobUpdates, audioProcessor.apvts, ParameterID::filterSustain.getParamID(), filterSustainKnob.slider };
     
-    SliderAttachment filterReleaseAttachment { audioProcessor.apvts, ParameterID::filterRelease.getParamID(), filterReleaseKnob.slider };
+    KnobAttachment filterReleaseAttachment { knobUpdates, audioProcessor.apvts, ParameterID::filterRelease.getParamID(), filterReleaseKnob.slider };
     
-    SliderAttachment oscMixAttachment { audioProcessor.apvts, ParameterID::oscMix.getParamID(),
+    KnobAttachment oscMixAttachment { knobUpdates, audioProcessor.apvts, ParameterID::oscMix.getParamID(),
         oscMixKnob.slider};
     
-    SliderAttachment oscTuneAttachment { audioProcessor.apvts, ParameterID::oscTune.getParamID(),
+    KnobAttachment oscTuneAttachment { knobUpdates, audioProcessor.apvts, ParameterID::oscTune.getParamID(),
         oscTuneKnob.slider};
     
-    SliderAttachment oscFineAttachment { audioProcessor.apvts, ParameterID::oscFine.getParamID(),
+    KnobAttachment oscFineAttachment { knobUpdates, audioProcessor.apvts, ParameterID::oscFine.getParamID(),
         oscFineKnob.slider};
     
-    SliderAttachment glideRateAttachment { audioProcessor.apvts, ParameterID::glideRate.getParamID(),
+    KnobAttachment glideRateAttachment { knobUpdates, audioProcessor.apvts, ParameterID::glideRate.getParamID(),
         glideRateKnob.slider};
     
-    SliderAttachment glideBendAttachment { audioProcessor.apvts, ParameterID::glideBend.getParamID(),
+    KnobAttachment glideBendAttachment { knobUpdates, audioProcessor.apvts, ParameterID::glideBend.getParamID(),
         glideBendKnob.slider};
     
-    SliderAttachment glideModeAttachment { audioProcessor.apvts, ParameterID::glideMode.getParamID(),
+    KnobAttachment glideModeAttachment { knobUpdates, audioProcessor.apvts, ParameterID::glideMode.getParamID(),
         glideModeKnob.slider};
     
-    SliderAttachment envAttackAttachment { audioProcessor.apvts, ParameterID::envAttack.getParamID(),
+    KnobAttachment envAttackAttachment { knobUpdates, audioProcessor.apvts, ParameterID::envAttack.getParamID(),
         envAttackKnob.slider};
     
-    SliderAttachment envDecayAttachment { audioProcessor.apvts, ParameterID::envDecay.getParamID(),
+    KnobAttachment envDecayAttachment { knobUpdates, audioProcessor.apvts, ParameterID::envDecay.getParamID(),
         envDecayKnob.slider};
     
-    SliderAttachment envSustainAttachment { audioProcessor.apvts, ParameterID::envSustain.getParamID(), envSustainKnob.slider};
+    KnobAttachment envSustainAttachment { knobUpdates, audioProcessor.apvts, ParameterID::envSustain.getParamID(), envSustainKnob.slider};
     
-    SliderAttachment envReleaseAttachment { audioProcessor.apvts, ParameterID::envRelease.getParamID(), envReleaseKnob.slider};
+    KnobAttachment envReleaseAttachment { knobUpdates, audioProcessor.apvts, ParameterID::envRelease.getParamID(), envReleaseKnob.slider};
     
-    SliderAttachment lfoRateAttachment { audioProcessor.apvts, ParameterID::lfoRate.getParamID(),
+    KnobAttachment lfoRateAttachment { knobUpdates, audioProcessor.apvts, ParameterID::lfoRate.getParamID(),
         lfoRateKnob.slider};
     
-    SliderAttachment vibratoAttachment { audioProcessor.apvts, ParameterID::vibrato.getParamID(),
+    KnobAttachment vibratoAttachment { knobUpdates, audioProcessor.apvts, ParameterID::vibrato.getParamID(),
         vibratoKnob.slider};
     
-    SliderAttachment noiseAttachment { audioProcessor.apvts, ParameterID::noise.getParamID(),
+    KnobAttachment noiseAttachment { knobUpdates, audioProcessor.apvts, ParameterID::noise.getParamID(),
         noiseKnob.slider};
     
-    SliderAttachment octaveAttachment { audioProcessor.apvts, ParameterID::octave.getParamID(),
+    KnobAttachment octaveAttachment { knobUpdates, audioProcessor.apvts, ParameterID::octave.getParamID(),
         octaveKnob.slider};
     
-    SliderAttachment tuningAttachment { audioProcessor.apvts, ParameterID::tuning.getParamID(),
+    KnobAttachment tuningAttachment { knobUpdates, audioProcessor.apvts, ParameterID::tuning.getParamID(),
         tuningKnob.slider};
+    
+    KnobAttachment morphAttachment { knobUpdates, audioProcessor.apvts, ParameterID::morph.getParamID(),
+        morphKnob.slider};
 
     ButtonAttachment polyModeAttachment {audioProcessor.apvts, ParameterID::polyMode.getParamID(),
         polyModeButton};
@@ -9,6 +9,7 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 #include "Utils.h"
+#include "FactoryPresets.h"
 
 //New name of the top-level XML element that contains separate child
 //elements for the <Parameter> section as well as the learned MIDI CC number.
@@ -16,18 +17,25 @@ static const juce::Identifier pluginTag = "PLUGIN";
 static const juce::Identifier extraTag = "EXTRA";
 static const juce::Identifier midiCCAttribute = "midiCC";
 
+//The binary state chunk starts with these bytes: "JX11" read as a
+//little-endian integer, followed by the version of the format.
+//Older hosts may still hand us XML state (with JUCE's own header).
+static const int stateMagic = 0x3131584A;
+//Each change to the format gets a new version, and setStateInformation()
+//reads a section only if the version has it:
+//  1  parameters, Filter Reso CC, program
+//     (later builds of version 1 add multi-timbral parts and MPE)
+//  2  MIDI learn table, after the parts and MPE
+//     (later builds of version 2 add the limiter)
+//  3  morph, after the limiter
+//  4  number of part programs before the part programs
+static const int stateVersion = 4;
+
 
 //==============================================================================
 JX11AudioProcessor::JX11AudioProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
-     : AudioProcessor (BusesProperties()
-                     #if ! JucePlugin_IsMidiEffect
-                      #if ! JucePlugin_IsSynth
-                       .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
-                      #endif
-                       .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
-                     #endif
-                       )
+     : AudioProcessor (createBusesProperties())
 #endif
 {
 //              Grabs the parameter with the identifier
@@ -60,20 +68,105 @@ JX11AudioProcessor::JX11AudioProcessor()
     Utils::castParameter(apvts, ParameterID::tuning, tuningParam);
     Utils::castParameter(apvts, ParameterID::outputLevel, outputLevelParam);
     Utils::castParameter(apvts, ParameterID::polyMode, polyModeParam);
+    Utils::castParameter(apvts, ParameterID::morph, morphParam);
+    
+//    Same order as the param array in Preset.
+    juce::RangedAudioParameter* presetOrder[NUM_PARAMS] = {
+            oscMixParam,
+            oscTuneParam,
+            oscFineParam,
+            glideModeParam,
+            glideRateParam,
+            glideBendParam,
+            filterFreqParam,
+            filterResoParam,
+            filterEnvParam,
+            filterLFOParam,
+            filterVelocityParam,
+            filterAttackParam,
+            filterDecayParam,
+            filterSustainParam,
+            filterReleaseParam,
+            envAttackParam,
+            envDecayParam,
+            envSustainParam,
+            envReleaseParam,
+            lfoRateParam,
+            vibratoParam,
+            noiseParam,
+            octaveParam,
+            tuningParam,
+            outputLevelParam,
+            polyModeParam,
+    };
+    std::copy(std::begin(presetOrder), std::end(presetOrder), params);
+    
+    
+//    The parameters already start at their default values, which
+//    are the settings of the "Init" program. Calling
+//    setCurrentProgram(0) here would only send 26 notifications
+//    to the host while the plug-in is being constructed.
+    currentProgram = 0;
+    
+//    All parts start out with the main sound.
+    for (auto& program : partPrograms) {
+        program.store(-1);
+    }
+    loadedPartPrograms.fill(-1);
+    
+//    No controller has moved a parameter yet.
+    for (auto& value : ccPendingValue) {
+        value.store(-1.0f);
+    }
     
+//    The controller that MIDI learn used to be limited to.
+    MidiLearnMap::Table table;
+    table[0x47].param = FILTER_RESO;
+    midiMap.set(table);
     
-    createPrograms();
-    setCurrentProgram(0);
+   #if JUCE_DEBUG
+    for (int i = 0; i < NUM_PARAMS; ++i) {
+        float defaultValue = params[i]->convertFrom0to1(params[i]->getDefaultValue());
+        jassert(std::abs(defaultValue - factoryPresets[0].param[i]) < 0.0001f);
+    }
+   #endif
     
 //    Add the listener.
 //    Connecting the valueTreePropertyChanged
 //    method to the APVTS.
     apvts.state.addListener(this);
     
+    shared->logThread.add(log);
+    
+//    Checks for Program Change requests and controller
+//    changes from the audio thread.
+    startTimerHz(30);
+}
+
+juce::AudioProcessor::BusesProperties JX11AudioProcessor::createBusesProperties()
+{
+    BusesProperties buses;
+   #if ! JucePlugin_IsMidiEffect
+    #if ! JucePlugin_IsSynth
+    buses = buses.withInput("Input", juce::AudioChannelSet::stereo(), true);
+    #endif
+    buses = buses.withOutput("Output", juce::AudioChannelSet::stereo(), true);
+    
+//    One optional output per multi-timbral part, named after its
+//    MIDI channel. They are off until the host enables them, and
+//    a part without its own output plays through the main one.
+    for (int channel = 2; channel <= NUM_PARTS; ++channel) {
+        buses = buses.withOutput("Part " + juce::String(channel),
+                                 juce::AudioChannelSet::stereo(), false);
+    }
+   #endif
+    return buses;
 }
 
 JX11AudioProcessor::~JX11AudioProcessor()
 {
+    stopTimer();
+    shared->logThread.remove(log);
     apvts.state.removeListener(this);
 }
 
@@ -112,13 +205,13 @@ bool JX11AudioProcessor::isMidiEffect() const
 
 double JX11AudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    return tailLength.load();
 }
 
 int JX11AudioProcessor::getNumPrograms()
 {
 //    Number of presets(programs)
-    return int(presets.size());
+    return NUM_PRESETS;
 }
 
 int JX11AudioProcessor::getCurrentProgram()
@@ -129,40 +222,24 @@ int JX11AudioProcessor::getCurrentProgram()
 void JX11AudioProcessor::setCurrentProgram (int index)
 {
     currentProgram = index;
- 
-//    Knobs
-//    AudioParameterFloat and AudioParameterChoice objects.
-    juce::RangedAudioParameter *params[NUM_PARAMS] = {
-            oscMixParam,
-            oscTuneParam,
-            oscFineParam,
-            glideModeParam,
-            glideRateParam,
-            glideBendParam,
-            filterFreqParam,
-            filterResoParam,
-            filterEnvParam,
-            filterLFOParam,
-            filterVelocityParam,
-            filterAttackParam,
-            filterDecayParam,
-            filterSustainParam,
-            filterReleaseParam,
-            envAttackParam,
-            envDecayParam,
-            envSustainParam,
-            envReleaseParam,
-            lfoRateParam,
-            vibratoParam,
-            noiseParam,
-            octaveParam,
-            tuningParam,
-            outputLevelParam,
-            polyModeParam,
-    };
     
-//    Preset object extracted from the vector
-    const Preset& preset = presets[index];
+//    Preset object extracted from the factory table
+    loadPreset(factoryPresets[index]);
+}
+
+void JX11AudioProcessor::loadPreset(const Preset& preset)
+{
+    JX11_ASSERT_NOT_REALTIME("loadPreset()");
+    
+//    A new preset ends the morph, otherwise it would
+//    override the values that are loaded here.
+    clearMorph();
+    
+//    Controller moves that haven't reached their
+//    parameters yet would overwrite the preset.
+    for (auto& value : ccPendingValue) {
+        value.store(-1.0f);
+    }
     
 //     It loops through the 26 elements in the Preset
 //    object’s params array and assigns their values
@@ -183,12 +260,54 @@ void JX11AudioProcessor::setCurrentProgram (int index)
 //    notes cause  an effect on changing presets.
 //    Parameter values could have big jumps, which leads
 //    for example to infinite audio values.
-    reset();
+//    This method runs on the message thread (or whichever thread
+//    the host uses), so the synth is not reset here directly.
+//    processBlock() does it at the next block boundary.
+    programChanged.store(true);
+}
+
+void JX11AudioProcessor::timerCallback()
+{
+//    Loads the program that was requested by a MIDI
+//    Program Change message, if any.
+    int program = pendingProgram.exchange(-1);
+    if (program >= 0) {
+        setCurrentProgram(program);
+    }
+    
+//    A controller was learned.
+    int cc = learnedCC.exchange(-1);
+    if (cc >= 0) {
+        midiMap.learn(cc, midiLearnParam.load());
+    }
+    
+//    Moves the parameters that controllers have changed. Only clears
+//    the pending value if no newer one came in meanwhile, so the
+//    audio thread keeps using its own until the parameter has it.
+    for (int i = 0; i < NUM_PARAMS; ++i) {
+        float value = ccPendingValue[i].load();
+        if (value >= 0.0f) {
+            params[i]->setValueNotifyingHost(value);
+            ccPendingValue[i].compare_exchange_strong(value, -1.0f);
+        }
+    }
+}
+
+void JX11AudioProcessor::setLimiterEnabled(bool enabled)
+{
+    limiterEnabled = enabled;
+    setLatencySamples(enabled ? outputStages[0].getLatency() : 0);
+}
+
+void JX11AudioProcessor::startMidiLearn()
+{
+    midiLearnParam = FILTER_RESO;
+    midiLearn = true;
 }
 
 const juce::String JX11AudioProcessor::getProgramName (int index)
 {
-    return {presets[index].name};
+    return {factoryPresets[index].name};
 }
 
 void JX11AudioProcessor::changeProgramName (int /*index*/, const juce::String& /*newName*/)
@@ -196,77 +315,147 @@ void JX11AudioProcessor::changeProgramName (int /*index*/, const juce::String& /
 //    Not supported by JX11
 }
 
-void JX11AudioProcessor::createPrograms()
-{
-    presets.emplace_back("Init", 0.00f, -12.00f, 0.00f, 0.00f, 35.00f, 0.00f, 100.00f, 15.00f, 50.00f, 0.00f, 0.00f, 0.00f, 30.00f, 0.00f, 25.00f, 0.00f, 50.00f, 100.00f, 30.00f, 0.81f, 0.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("5th Sweep Pad", 100.00f, -7.00f, -6.30f, 1.00f, 32.00f, 0.00f, 90.00f, 60.00f, -76.00f, 0.00f, 0.00f, 90.00f, 89.00f, 90.00f, 73.00f, 0.00f, 50.00f, 100.00f, 71.00f, 0.81f, 30.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Echo Pad [SA]", 88.00f, 0.00f, 0.00f, 0.00f, 49.00f, 0.00f, 46.00f, 76.00f, 38.00f, 10.00f, 38.00f, 100.00f, 86.00f, 76.00f, 57.00f, 30.00f, 80.00f, 68.00f, 66.00f, 0.79f, -74.00f, 25.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Space Chimes [SA]", 88.00f, 0.00f, 0.00f, 0.00f, 49.00f, 0.00f, 49.00f, 82.00f, 32.00f, 8.00f, 78.00f, 85.00f, 69.00f, 76.00f, 47.00f, 12.00f, 22.00f, 55.00f, 66.00f, 0.89f, -32.00f, 0.00f, 2.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Solid Backing", 100.00f, -12.00f, -18.70f, 0.00f, 35.00f, 0.00f, 30.00f, 25.00f, 40.00f, 0.00f, 26.00f, 0.00f, 35.00f, 0.00f, 25.00f, 0.00f, 50.00f, 100.00f, 30.00f, 0.81f, 0.00f, 50.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Velocity Backing [SA]", 41.00f, 0.00f, 9.70f, 0.00f, 8.00f, -1.68f, 49.00f, 1.00f, -32.00f, 0.00f, 86.00f, 61.00f, 87.00f, 100.00f, 93.00f, 11.00f, 48.00f, 98.00f, 32.00f, 0.81f, 0.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Rubber Backing [ZF]", 29.00f, 12.00f, -5.60f, 0.00f, 18.00f, 5.06f, 35.00f, 15.00f, 54.00f, 14.00f, 8.00f, 0.00f, 42.00f, 13.00f, 21.00f, 0.00f, 56.00f, 0.00f, 32.00f, 0.20f, 16.00f, 22.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("808 State Lead", 100.00f, 7.00f, -7.10f, 2.00f, 34.00f, 12.35f, 65.00f, 63.00f, 50.00f, 16.00f, 0.00f, 0.00f, 30.00f, 0.00f, 25.00f, 17.00f, 50.00f, 100.00f, 3.00f, 0.81f, 0.00f, 0.00f, 1.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Mono Glide", 0.00f, -12.00f, 0.00f, 2.00f, 46.00f, 0.00f, 51.00f, 0.00f, 0.00f, 0.00f, -100.00f, 0.00f, 30.00f, 0.00f, 25.00f, 37.00f, 50.00f, 100.00f, 38.00f, 0.81f, 24.00f, 0.00f, 0.00f, 0.00f, 0.00f, 0.00f);
-   presets.emplace_back("Detuned Techno Lead", 84.00f, 0.00f, -17.20f, 2.00f, 41.00f, -0.15f, 54.00f, 1.00f, 16.00f, 21.00f, 34.00f, 0.00f, 9.00f, 100.00f, 25.00f, 20.00f, 85.00f, 100.00f, 30.00f, 0.83f, -82.00f, 40.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Hard Lead [SA]", 71.00f, 12.00f, 0.00f, 0.00f, 24.00f, 36.00f, 56.00f, 52.00f, 38.00f, 19.00f, 40.00f, 100.00f, 14.00f, 65.00f, 95.00f, 7.00f, 91.00f, 100.00f, 15.00f, 0.84f, -34.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Bubble", 0.00f, -12.00f, -0.20f, 0.00f, 71.00f, -0.00f, 23.00f, 77.00f, 60.00f, 32.00f, 26.00f, 40.00f, 18.00f, 66.00f, 14.00f, 0.00f, 38.00f, 65.00f, 16.00f, 0.48f, 0.00f, 0.00f, 1.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Monosynth", 62.00f, -12.00f, 0.00f, 1.00f, 35.00f, 0.02f, 64.00f, 39.00f, 2.00f, 65.00f, -100.00f, 7.00f, 52.00f, 24.00f, 84.00f, 13.00f, 30.00f, 76.00f, 21.00f, 0.58f, -40.00f, 0.00f, -1.00f, 0.00f, 0.00f, 0.00f);
-   presets.emplace_back("Moogcury Lite", 81.00f, 24.00f, -9.80f, 1.00f, 15.00f, -0.97f, 39.00f, 17.00f, 38.00f, 40.00f, 24.00f, 0.00f, 47.00f, 19.00f, 37.00f, 0.00f, 50.00f, 20.00f, 33.00f, 0.38f, 6.00f, 0.00f, -2.00f, 0.00f, 0.00f, 0.00f);
-   presets.emplace_back("Gangsta Whine", 0.00f, 0.00f, 0.00f, 2.00f, 44.00f, 0.00f, 41.00f, 46.00f, 0.00f, 0.00f, -100.00f, 0.00f, 0.00f, 100.00f, 25.00f, 15.00f, 50.00f, 100.00f, 32.00f, 0.81f, -2.00f, 0.00f, 2.00f, 0.00f, 0.00f, 0.00f);
-   presets.emplace_back("Higher Synth [ZF]", 48.00f, 0.00f, -8.80f, 0.00f, 0.00f, 0.00f, 50.00f, 47.00f, 46.00f, 30.00f, 60.00f, 0.00f, 10.00f, 0.00f, 7.00f, 0.00f, 42.00f, 0.00f, 22.00f, 0.21f, 18.00f, 16.00f, 2.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("303 Saw Bass", 0.00f, 0.00f, 0.00f, 1.00f, 49.00f, 0.00f, 55.00f, 75.00f, 38.00f, 35.00f, 0.00f, 0.00f, 56.00f, 0.00f, 56.00f, 0.00f, 80.00f, 100.00f, 24.00f, 0.26f, -2.00f, 0.00f, -2.00f, 0.00f, 0.00f, 0.00f);
-   presets.emplace_back("303 Square Bass", 75.00f, 0.00f, 0.00f, 1.00f, 49.00f, 0.00f, 55.00f, 75.00f, 38.00f, 35.00f, 0.00f, 14.00f, 49.00f, 0.00f, 39.00f, 0.00f, 80.00f, 100.00f, 24.00f, 0.26f, -2.00f, 0.00f, -2.00f, 0.00f, 0.00f, 0.00f);
-   presets.emplace_back("Analog Bass", 100.00f, -12.00f, -10.90f, 1.00f, 19.00f, 0.00f, 30.00f, 51.00f, 70.00f, 9.00f, -100.00f, 0.00f, 88.00f, 0.00f, 21.00f, 0.00f, 50.00f, 100.00f, 46.00f, 0.81f, 0.00f, 0.00f, -1.00f, 0.00f, 0.00f, 0.00f);
-   presets.emplace_back("Analog Bass 2", 100.00f, -12.00f, -10.90f, 0.00f, 19.00f, 13.44f, 48.00f, 43.00f, 88.00f, 0.00f, 60.00f, 0.00f, 0.00f, 0.00f, 0.00f, 0.00f, 61.00f, 100.00f, 32.00f, 0.81f, 0.00f, 0.00f, -1.00f, 0.00f, 0.00f, 0.00f);
-   presets.emplace_back("Low Pulses", 97.00f, -12.00f, -3.30f, 0.00f, 35.00f, 0.00f, 80.00f, 40.00f, 4.00f, 0.00f, 0.00f, 0.00f, 77.00f, 0.00f, 25.00f, 0.00f, 50.00f, 100.00f, 30.00f, 0.81f, -68.00f, 0.00f, -2.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Sine Infra-Bass", 0.00f, -12.00f, 0.00f, 0.00f, 35.00f, 0.00f, 33.00f, 76.00f, 6.00f, 0.00f, 0.00f, 0.00f, 30.00f, 0.00f, 25.00f, 0.00f, 55.00f, 25.00f, 30.00f, 0.81f, 4.00f, 0.00f, -2.00f, 0.00f, 0.00f, 0.00f);
-   presets.emplace_back("Wobble Bass [SA]", 100.00f, -12.00f, -8.80f, 0.00f, 82.00f, 0.21f, 72.00f, 47.00f, -32.00f, 34.00f, 64.00f, 20.00f, 69.00f, 100.00f, 15.00f, 9.00f, 50.00f, 100.00f, 7.00f, 0.81f, -8.00f, 0.00f, -1.00f, 0.00f, 0.00f, 0.00f);
-   presets.emplace_back("Squelch Bass", 100.00f, -12.00f, -8.80f, 0.00f, 35.00f, 0.00f, 67.00f, 70.00f, -48.00f, 0.00f, 0.00f, 48.00f, 69.00f, 100.00f, 15.00f, 0.00f, 50.00f, 100.00f, 7.00f, 0.81f, -8.00f, 0.00f, -1.00f, 0.00f, 0.00f, 0.00f);
-   presets.emplace_back("Rubber Bass [ZF]", 49.00f, -12.00f, 1.60f, 1.00f, 35.00f, 0.00f, 36.00f, 15.00f, 50.00f, 20.00f, 0.00f, 0.00f, 38.00f, 0.00f, 25.00f, 0.00f, 60.00f, 100.00f, 22.00f, 0.19f, 0.00f, 0.00f, -2.00f, 0.00f, 0.00f, 0.00f);
-   presets.emplace_back("Soft Pick Bass", 37.00f, 0.00f, 7.80f, 0.00f, 22.00f, 0.00f, 33.00f, 47.00f, 42.00f, 16.00f, 18.00f, 0.00f, 0.00f, 0.00f, 25.00f, 4.00f, 58.00f, 0.00f, 22.00f, 0.15f, -12.00f, 33.00f, -2.00f, 0.00f, 0.00f, 0.00f);
-   presets.emplace_back("Fretless Bass", 50.00f, 0.00f, -14.40f, 1.00f, 34.00f, 0.00f, 51.00f, 0.00f, 16.00f, 0.00f, 34.00f, 0.00f, 9.00f, 0.00f, 25.00f, 20.00f, 85.00f, 0.00f, 30.00f, 0.81f, 40.00f, 0.00f, -2.00f, 0.00f, 0.00f, 0.00f);
-   presets.emplace_back("Whistler", 23.00f, 0.00f, -0.70f, 0.00f, 35.00f, 0.00f, 33.00f, 100.00f, 0.00f, 0.00f, 0.00f, 0.00f, 29.00f, 0.00f, 25.00f, 68.00f, 39.00f, 58.00f, 36.00f, 0.81f, 28.00f, 38.00f, 2.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Very Soft Pad", 39.00f, 0.00f, -4.90f, 2.00f, 12.00f, 0.00f, 35.00f, 78.00f, 0.00f, 0.00f, 0.00f, 0.00f, 30.00f, 0.00f, 25.00f, 35.00f, 50.00f, 80.00f, 70.00f, 0.81f, 0.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Pizzicato", 0.00f, -12.00f, 0.00f, 0.00f, 35.00f, 0.00f, 23.00f, 20.00f, 50.00f, 0.00f, 0.00f, 0.00f, 22.00f, 0.00f, 25.00f, 0.00f, 47.00f, 0.00f, 30.00f, 0.81f, 0.00f, 80.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Synth Strings", 100.00f, 0.00f, -7.10f, 0.00f, 0.00f, -0.97f, 42.00f, 26.00f, 50.00f, 14.00f, 38.00f, 0.00f, 67.00f, 55.00f, 97.00f, 82.00f, 70.00f, 100.00f, 42.00f, 0.84f, 34.00f, 30.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Synth Strings 2", 75.00f, 0.00f, -3.80f, 0.00f, 49.00f, 0.00f, 55.00f, 16.00f, 38.00f, 8.00f, -60.00f, 76.00f, 29.00f, 76.00f, 100.00f, 46.00f, 80.00f, 100.00f, 39.00f, 0.79f, -46.00f, 0.00f, 1.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Leslie Organ", 0.00f, 0.00f, 0.00f, 0.00f, 13.00f, -0.38f, 38.00f, 74.00f, 8.00f, 20.00f, -100.00f, 0.00f, 55.00f, 52.00f, 31.00f, 0.00f, 17.00f, 73.00f, 28.00f, 0.87f, -52.00f, 0.00f, -1.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Click Organ", 50.00f, 12.00f, 0.00f, 0.00f, 35.00f, 0.00f, 44.00f, 50.00f, 30.00f, 16.00f, -100.00f, 0.00f, 0.00f, 18.00f, 0.00f, 0.00f, 75.00f, 80.00f, 0.00f, 0.81f, -2.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Hard Organ", 89.00f, 19.00f, -0.90f, 0.00f, 35.00f, 0.00f, 51.00f, 62.00f, 8.00f, 0.00f, -100.00f, 0.00f, 37.00f, 0.00f, 100.00f, 4.00f, 8.00f, 72.00f, 4.00f, 0.77f, -2.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Bass Clarinet", 100.00f, 0.00f, 0.00f, 1.00f, 0.00f, 0.00f, 51.00f, 10.00f, 0.00f, 11.00f, 0.00f, 0.00f, 0.00f, 0.00f, 25.00f, 35.00f, 65.00f, 65.00f, 32.00f, 0.79f, -2.00f, 20.00f, -1.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Trumpet", 0.00f, 0.00f, 0.00f, 1.00f, 6.00f, 0.00f, 57.00f, 0.00f, -36.00f, 15.00f, 0.00f, 21.00f, 15.00f, 0.00f, 25.00f, 24.00f, 60.00f, 80.00f, 10.00f, 0.75f, 10.00f, 25.00f, 1.00f, 0.00f, 0.00f, 0.00f);
-   presets.emplace_back("Soft Horn", 12.00f, 19.00f, 1.90f, 0.00f, 35.00f, 0.00f, 50.00f, 21.00f, -42.00f, 12.00f, 20.00f, 0.00f, 35.00f, 36.00f, 25.00f, 8.00f, 50.00f, 100.00f, 27.00f, 0.83f, 2.00f, 10.00f, -1.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Brass Section", 43.00f, 12.00f, -7.90f, 0.00f, 28.00f, -0.79f, 50.00f, 0.00f, 18.00f, 0.00f, 0.00f, 24.00f, 16.00f, 91.00f, 8.00f, 17.00f, 50.00f, 80.00f, 45.00f, 0.81f, 0.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Synth Brass", 40.00f, 0.00f, -6.30f, 0.00f, 30.00f, -3.07f, 39.00f, 15.00f, 50.00f, 0.00f, 0.00f, 39.00f, 30.00f, 82.00f, 25.00f, 33.00f, 74.00f, 76.00f, 41.00f, 0.81f, -6.00f, 23.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Detuned Syn Brass [ZF]", 68.00f, 0.00f, 31.80f, 0.00f, 31.00f, 0.50f, 26.00f, 7.00f, 70.00f, 0.00f, 32.00f, 0.00f, 83.00f, 0.00f, 5.00f, 0.00f, 75.00f, 54.00f, 32.00f, 0.76f, -26.00f, 29.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Power PWM", 100.00f, -12.00f, -8.80f, 0.00f, 35.00f, 0.00f, 82.00f, 13.00f, 50.00f, 0.00f, -100.00f, 24.00f, 30.00f, 88.00f, 34.00f, 0.00f, 50.00f, 100.00f, 48.00f, 0.71f, -26.00f, 0.00f, -1.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Water Velocity [SA]", 76.00f, 0.00f, -1.40f, 0.00f, 49.00f, 0.00f, 87.00f, 67.00f, 100.00f, 32.00f, -82.00f, 95.00f, 56.00f, 72.00f, 100.00f, 4.00f, 76.00f, 11.00f, 46.00f, 0.88f, 44.00f, 0.00f, -1.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Ghost [SA]", 75.00f, 0.00f, -7.10f, 2.00f, 16.00f, -0.00f, 38.00f, 58.00f, 50.00f, 16.00f, 62.00f, 0.00f, 30.00f, 40.00f, 31.00f, 37.00f, 50.00f, 100.00f, 54.00f, 0.85f, 66.00f, 43.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Soft E.Piano", 31.00f, 0.00f, -0.20f, 0.00f, 35.00f, 0.00f, 34.00f, 26.00f, 6.00f, 0.00f, 26.00f, 0.00f, 22.00f, 0.00f, 39.00f, 0.00f, 80.00f, 0.00f, 44.00f, 0.81f, 2.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Thumb Piano", 72.00f, 15.00f, 50.00f, 0.00f, 35.00f, 0.00f, 37.00f, 47.00f, 8.00f, 0.00f, 0.00f, 0.00f, 45.00f, 0.00f, 39.00f, 0.00f, 39.00f, 0.00f, 48.00f, 0.81f, 20.00f, 0.00f, 1.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Steel Drums [ZF]", 81.00f, 12.00f, -12.00f, 0.00f, 18.00f, 2.30f, 40.00f, 30.00f, 8.00f, 17.00f, -20.00f, 0.00f, 42.00f, 23.00f, 47.00f, 12.00f, 48.00f, 0.00f, 49.00f, 0.53f, -28.00f, 34.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Car Horn", 57.00f, -1.00f, -2.80f, 0.00f, 35.00f, 0.00f, 46.00f, 0.00f, 36.00f, 0.00f, 0.00f, 46.00f, 30.00f, 100.00f, 23.00f, 30.00f, 50.00f, 100.00f, 31.00f, 1.00f, -24.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Helicopter", 0.00f, -12.00f, 0.00f, 0.00f, 35.00f, 0.00f, 8.00f, 36.00f, 38.00f, 100.00f, 0.00f, 100.00f, 100.00f, 0.00f, 100.00f, 96.00f, 50.00f, 100.00f, 92.00f, 0.97f, 0.00f, 100.00f, -2.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Arctic Wind", 0.00f, -12.00f, 0.00f, 0.00f, 35.00f, 0.00f, 16.00f, 85.00f, 0.00f, 28.00f, 0.00f, 37.00f, 30.00f, 0.00f, 25.00f, 89.00f, 50.00f, 100.00f, 89.00f, 0.24f, 0.00f, 100.00f, 2.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Thip", 100.00f, -7.00f, 0.00f, 0.00f, 35.00f, 0.00f, 0.00f, 100.00f, 94.00f, 0.00f, 0.00f, 2.00f, 20.00f, 0.00f, 20.00f, 0.00f, 46.00f, 0.00f, 30.00f, 0.81f, 0.00f, 78.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Synth Tom", 0.00f, -12.00f, 0.00f, 0.00f, 76.00f, 24.53f, 30.00f, 33.00f, 52.00f, 0.00f, 36.00f, 0.00f, 59.00f, 0.00f, 59.00f, 10.00f, 50.00f, 0.00f, 50.00f, 0.81f, 0.00f, 70.00f, -2.00f, 0.00f, 0.00f, 1.00f);
-   presets.emplace_back("Squelchy Frog", 50.00f, -5.00f, -7.90f, 2.00f, 77.00f, -36.00f, 40.00f, 65.00f, 90.00f, 0.00f, 0.00f, 33.00f, 50.00f, 0.00f, 25.00f, 0.00f, 70.00f, 65.00f, 18.00f, 0.32f, 100.00f, 0.00f, -2.00f, 0.00f, 0.00f, 1.00f);
-}
-
 std::vector<std::string> JX11AudioProcessor::getPresetNames() const
 {
     std::vector<std::string> names;
-    for (const auto& preset : presets) {
+    for (const auto& preset : factoryPresets) {
         names.push_back(preset.name);
     }
     return names;
 }
+
+void JX11AudioProcessor::loadUserPreset(int record)
+{
+    Preset preset;
+    if (shared->getUserPresets().getPreset(record, preset)) {
+        loadPreset(preset);
+    }
+}
+
+bool JX11AudioProcessor::saveUserPreset(const juce::String& name, const juce::StringArray& tags)
+{
+    Preset preset;
+    name.copyToUTF8(preset.name, sizeof(preset.name));
+    for (int i = 0; i < NUM_PARAMS; ++i) {
+        preset.param[i] = params[i]->convertFrom0to1(params[i]->getValue());
+    }
+    return shared->getUserPresets().append(preset, tags);
+}
+
+void JX11AudioProcessor::setMorphTarget(int slot)
+{
+    jassert(slot == 0 || slot == 1);
+    for (int i = 0; i < NUM_PARAMS; ++i) {
+        morphTargets[slot][i] = params[i]->convertFrom0to1(params[i]->getValue());
+    }
+    morphTargetSet[slot] = true;
+    buildMorphTable();
+}
+
+void JX11AudioProcessor::clearMorph()
+{
+    morphTargetSet[0] = false;
+    morphTargetSet[1] = false;
+    morphActive.store(false);
+    
+//    The parameters are in charge again.
+    parametersChanged.store(true);
+}
+
+void JX11AudioProcessor::buildMorphTable()
+{
+    JX11_ASSERT_NOT_REALTIME("buildMorphTable()");
+    
+//    The table depends on the sample rate, so it can't be built
+//    before prepareToPlay(), which calls this method again.
+    if (!morphTargetSet[0] || !morphTargetSet[1] || getSampleRate() <= 0.0) {
+        return;
+    }
+    
+    MorphTable table;
+    for (int i = 0; i <= MORPH_STEPS; ++i) {
+        float t = float(i) / float(MORPH_STEPS);
+        float values[NUM_PARAMS];
+        for (int j = 0; j < NUM_PARAMS; ++j) {
+            values[j] = morphTargets[0][j] + (morphTargets[1][j] - morphTargets[0][j]) * t;
+        }
+        table[size_t(i)] = calcSynthParams(values, float(getSampleRate()));
+    }
+    
+    {
+        const RealtimeCheck::SpinLock::ScopedLockType lock(morphLock);
+        morphTable = table;
+    }
+    morphTableChanged.store(true);
+    morphActive.store(true);
+}
+
+void JX11AudioProcessor::updateMorph(bool force)
+{
+    if (morphTableChanged.load()) {
+//        If the message thread is busy writing the table,
+//        the copy is simply tried again in the next block.
+        const RealtimeCheck::SpinLock::ScopedTryLockType lock(morphLock);
+        if (lock.isLocked()) {
+            audioMorphTable = morphTable;
+            morphTableChanged.store(false);
+            hasMorphTable = true;
+            force = true;
+        }
+    }
+    if (!hasMorphTable) {
+        return;
+    }
+    
+    float morph = morphParam->get() / 100.0f;
+    if (!force && morph == lastMorph) {
+        return;
+    }
+    lastMorph = morph;
+    
+    float position = morph * float(MORPH_STEPS);
+    int index = juce::jlimit(0, MORPH_STEPS - 1, int(position));
+    float t = position - float(index);
+    applySynthParams(SynthParams::interpolate(audioMorphTable[size_t(index)],
+                                              audioMorphTable[size_t(index + 1)], t));
+}
 //==============================================================================
 void JX11AudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
 //    Synth instance reacts to changes
 //    In JX11 they don't allocate, but still worth setting up
-    synth.allocateResources(sampleRate, samplesPerBlock);
+    for (auto& synth : engines) {
+        synth.allocateResources(sampleRate, samplesPerBlock);
+    }
+    for (auto& part : parts) {
+        part.allocateResources(sampleRate, samplesPerBlock);
+    }
+    
+//    Preset changes fade out the old engine over 30 ms.
+    crossfadeLength = juce::jmax(1, int(sampleRate * 0.03));
+    crossfadeBuffer.setSize(2, samplesPerBlock);
+    partBuffer.setSize(2, samplesPerBlock);
+    
+//    The settings of the parts depend on the sample rate,
+//    this makes updateParts() calculate them again.
+    loadedPartPrograms.fill(-2);
+    
+    scope.setSampleRate(sampleRate);
+    
+//    The limiter's lookahead is a fixed time, so its
+//    latency in samples changes with the sample rate.
+    for (auto& stage : outputStages) {
+        stage.prepare(sampleRate);
+    }
+    setLatencySamples(limiterEnabled ? outputStages[0].getLatency() : 0);
+    
+//    Controllers glide to a new value in 20 ms.
+    for (auto& smoother : ccSmoothers) {
+        smoother.reset(sampleRate, 0.02);
+    }
+    
+//    The morph table depends on the sample rate.
+    buildMorphTable();
     
 //    Forces update() to be executed when processBlock()
 //    is called the first time.
@@ -282,21 +471,78 @@ void JX11AudioProcessor::releaseResources()
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
     
-    synth.deallocateResources();
+    for (auto& synth : engines) {
+        synth.deallocateResources();
+    }
+    for (auto& part : parts) {
+        part.deallocateResources();
+    }
 }
 
 void JX11AudioProcessor::reset()
+{
+    resetEngines();
+    
+    for (auto& part : parts) {
+        part.reset();
+        part.outputLevelSmoother.setCurrentAndTargetValue(
+                juce::Decibels::decibelsToGain(outputLevelParam->get()));
+    }
+    for (auto& stage : outputStages) {
+        stage.reset();
+    }
+    
+//    Forgets controller MSBs from before.
+    midiDecoder.reset();
+    
+    midiLearn = false;
+    
+//    The parameters take over from the controllers again.
+    std::fill(std::begin(ccActive), std::end(ccActive), false);
+}
+
+void JX11AudioProcessor::resetEngines()
 {
 //    Call synth reset() from main class
-    synth.reset();
+    for (auto& synth : engines) {
+        synth.reset();
+        
+//        Informs the smoother about the initial settting of the
+//        output level.
+        synth.outputLevelSmoother.setCurrentAndTargetValue(
+                juce::Decibels::decibelsToGain(outputLevelParam->get()));
+    }
+    
+//    Cancels any crossfade that is still running.
+    fadingEngine = -1;
+    crossfadeRemaining = 0;
+    
+//    The parts may still be playing through the main output,
+//    so its limiter only starts over if they're quiet too.
+    if (!arePartsPlaying()) {
+        outputStages[0].reset();
+    }
+}
+
+void JX11AudioProcessor::startCrossfade()
+{
+//    If a crossfade was already running, the engine that was
+//    fading out gets cut off and becomes the new active engine.
+    fadingEngine = activeEngine;
+    activeEngine = 1 - activeEngine;
+    crossfadeRemaining = crossfadeLength;
+    
+    Synth& oldSynth = engines[fadingEngine];
+    Synth& synth = engines[activeEngine];
     
-//    Informs the smoother about the initial settting of the
-//    output level.
+//    The old engine keeps its parameters and only
+//    releases its notes.
+    oldSynth.releaseAll();
+    
+//    The new engine starts from silence.
+    synth.reset();
     synth.outputLevelSmoother.setCurrentAndTargetValue(
             juce::Decibels::decibelsToGain(outputLevelParam->get()));
-    
-    midiLearn = false;
-    midiLearnCC = synth.resoCC;
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -313,6 +559,15 @@ bool JX11AudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) con
     if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
      && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
         return false;
+    
+//    The part outputs are either off, mono or stereo.
+    for (int bus = 1; bus < layouts.outputBuses.size(); ++bus) {
+        auto set = layouts.getChannelSet(false, bus);
+        if (!set.isDisabled()
+         && set != juce::AudioChannelSet::mono()
+         && set != juce::AudioChannelSet::stereo())
+            return false;
+    }
 
     // This checks if the input layout matches the output layout
    #if ! JucePlugin_IsSynth
@@ -329,16 +584,41 @@ void JX11AudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::M
 {
     juce::ScopedNoDenormals noDenormals;
     
-    auto totalNumInputChannels  = getTotalNumInputChannels();
-    auto totalNumOutputChannels = getTotalNumOutputChannels();
-
+//    With JX11_REALTIME_CHECKS, anything below that
+//    allocates or blocks stops the plug-in.
+    RealtimeCheck::Scope realtimeScope;
     
-    for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
-        buffer.clear (i, 0, buffer.getNumSamples());
+//    The output channels aren't cleared here. render() writes every
+//    sample of the main output and of each enabled part output once.
     
-//    We can access midiLearnCC variable from any
-//    thread, since it’s atomic.
-    synth.resoCC = midiLearnCC;
+//    Both engines, so the one fading out of a preset change
+//    keeps reading its notes the same way.
+    for (auto& synth : engines) {
+        synth.mpeEnabled = mpe;
+    }
+    
+//    Switching multi-timbral mode off cuts the parts off from their
+//    MIDI channels, so their notes would never get a Note Off.
+//    Turning the limiter on or off starts its delay line over.
+    bool limit = limiterEnabled.load();
+    if (limit != limiterActive) {
+        limiterActive = limit;
+        for (auto& stage : outputStages) {
+            stage.reset();
+        }
+        updateTailLength();
+    }
+    
+    bool multi = multiTimbral.load() && !mpe.load();
+    if (multi != multiTimbralActive) {
+        multiTimbralActive = multi;
+        if (!multi) {
+            for (auto& part : parts) {
+                part.releaseAll();
+            }
+        }
+        updateTailLength();
+    }
     
 //    Thread-safe check, whether parametersChanged is true.
     bool expected = true;
@@ -349,50 +629,274 @@ void JX11AudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::M
 //    parameters. If the DAW works in offline mode it is faster
 //    than realtime. Preventing loss of parameter changes, we always
 //    update if isNonRealtime() is true. p.175
+    bool updated = false;
+    bool controlled = advanceMidiControl(buffer.getNumSamples());
     if (isNonRealtime() || parametersChanged.compare_exchange_strong(expected, false)) {
         update();
+        updated = true;
+    } else if (controlled) {
+//        Between two timer ticks only the controlled
+//        parameters have moved.
+        updateControlled();
+        updated = true;
+    }
+    
+//    A new program was loaded since the last block. The APVTS
+//    only flushes parameter changes to its ValueTree on a timer,
+//    so update() is called explicitly to pick up the new values
+//    in the same block as the reset.
+    if (programChanged.exchange(false)) {
+//        Only crossfade if there is something to fade out.
+//        The parts keep their notes, a program change on
+//        channel 1 is only about the main sound.
+        if (presetCrossfade && engines[activeEngine].isPlaying()) {
+            startCrossfade();
+        } else {
+            resetEngines();
+        }
+//        The new preset replaces what the controllers had set.
+        std::fill(std::begin(ccActive), std::end(ccActive), false);
+        update();
+        updated = true;
+    }
+    
+//    While morphing, the morph position decides the sound.
+//    update() has just overwritten it, so it's sent again.
+    if (morphActive) {
+        updateMorph(updated);
+    } else {
+        hasMorphTable = false;
+    }
+    
+//    Notes from the editor's keyboard.
+    numEditorEvents = editorMidi.pop(editorEvents.data(), int(editorEvents.size()));
+    
+//    Nothing is playing and nothing will start in this block: the
+//    output is all zeros, so the voices aren't rendered at all.
+//    clear() also marks the buffer as silent, which lets hosts that
+//    look at that skip processing it further.
+    if (isIdle(midiMessages)) {
+        buffer.clear();
+        return;
     }
     
 //    Processing midi messages by timestamps.
 //    Therefore, split them by events.
+    midiMapping = &midiMap.acquire();
     splitBufferByEvents(buffer, midiMessages);
+    midiMap.release();
+    midiMapping = nullptr;
+    
+//    Ear protection on every output, and the limiter if it's on.
+    for (int bus = 0; bus < NUM_PARTS; ++bus) {
+        float* outputBuffers[2];
+        if (getOutputBuffers(buffer, bus, 0, outputBuffers)) {
+            outputStages[size_t(bus)].process(outputBuffers[0], outputBuffers[1],
+                                              buffer.getNumSamples(), limiterActive, &log);
+        }
+    }
     
-    for (int channel = 0; channel < totalNumInputChannels; ++channel)
-    {
-        auto* channelData = buffer.getWritePointer (channel);
+//    The finished output, crossfade included, goes to the scope.
+    float* mainOutput[2];
+    getOutputBuffers(buffer, 0, 0, mainOutput);
+    scope.push(mainOutput[0], mainOutput[1], buffer.getNumSamples());
+    voiceMonitor.publish(engines[activeEngine]);
+}
+
+bool JX11AudioProcessor::isIdle(const juce::MidiBuffer& midiMessages) const
+{
+//    The output level must have settled as well, otherwise
+//    its smoother would skip ahead once the next note starts.
+    const Synth& synth = engines[activeEngine];
+    return midiMessages.isEmpty()
+        && numEditorEvents == 0
+        && fadingEngine < 0
+        && !synth.isPlaying()
+        && !synth.outputLevelSmoother.isSmoothing()
+        && !arePartsPlaying()
+        && areOutputStagesSilent();
+}
 
-        // ..do something to the data...
+bool JX11AudioProcessor::areOutputStagesSilent() const
+{
+    for (const auto& stage : outputStages) {
+        if (!stage.isSilent(limiterActive)) {
+            return false;
+        }
     }
+    return true;
 }
 
 void JX11AudioProcessor::update()
 {
+//    Current real values in the order of Preset::param.
+    for (int i = 0; i < NUM_PARAMS; ++i) {
+//        A controller may be ahead of the parameter.
+        float value = ccActive[i] ? ccSmoothers[i].getCurrentValue() : params[i]->getValue();
+        mainValues[i] = params[i]->convertFrom0to1(value);
+    }
     
-//    Noise
-//    --------------------------------------------------------------------------
+//    Parameter changes only go to the active engine. An engine
+//    that is fading out keeps the settings of the old preset.
+    applySynthParams(calcSynthParams(mainValues, float(getSampleRate())));
+}
+
+void JX11AudioProcessor::updateControlled()
+{
+    float sampleRate = float(getSampleRate());
+    bool releaseChanged = false;
+    for (int i = 0; i < NUM_PARAMS; ++i) {
+        if (ccActive[i]) {
+            mainValues[i] = params[i]->convertFrom0to1(ccSmoothers[i].getCurrentValue());
+            calcSynthParam(i, mainValues, sampleRate, mainParams);
+            releaseChanged = releaseChanged || i == ENV_RELEASE || i == FILTER_RELEASE;
+        }
+    }
+    
+    if (releaseChanged) {
+        mainTail = calcTailLength(mainParams, getSampleRate());
+    }
+    engines[activeEngine].applyParams(mainParams);
+    updateParts(true);
+}
+
+void JX11AudioProcessor::applySynthParams(const SynthParams& p)
+{
+    engines[activeEngine].applyParams(p);
+    mainParams = p;
+    mainTail = calcTailLength(p, getSampleRate());
+    updateParts(true);
+}
+
+void JX11AudioProcessor::updateParts(bool mainChanged)
+{
+    for (size_t i = 0; i < parts.size(); ++i) {
+        int program = partPrograms[i].load();
+        if (program < 0) {
+            if (mainChanged || loadedPartPrograms[i] != -1) {
+                parts[i].applyParams(mainParams);
+            }
+        } else if (program != loadedPartPrograms[i]) {
+//            The factory presets hold real parameter values,
+//            the same as update() reads from the parameters.
+            SynthParams p = calcSynthParams(factoryPresets[program].param, float(getSampleRate()));
+            parts[i].applyParams(p);
+            partTails[i] = calcTailLength(p, getSampleRate());
+        }
+        loadedPartPrograms[i] = juce::jmax(-1, program);
+    }
+    updateTailLength();
+}
+
+void JX11AudioProcessor::updateTailLength()
+{
+//    The longest release of the sounds that can play.
+    double tail = mainTail;
+    if (multiTimbralActive) {
+        for (size_t i = 0; i < parts.size(); ++i) {
+            tail = juce::jmax(tail, (loadedPartPrograms[i] < 0) ? mainTail : partTails[i]);
+        }
+    }
+    
+//    The limiter holds the last samples back for a little longer.
+    if (limiterActive && getSampleRate() > 0.0) {
+        tail += double(outputStages[0].getLatency()) / getSampleRate();
+    }
+    tailLength.store(tail);
+}
+
+double JX11AudioProcessor::calcTailLength(const SynthParams& p, double sampleRate)
+{
+    if (sampleRate <= 0.0) {
+        return 0.0;
+    }
+    
+//    The envelopes multiply their level by the release multiplier,
+//    so going from 1 to SILENCE takes log(SILENCE) / log(multiplier)
+//    steps. The amplitude envelope steps once per sample.
+    double silence = std::log(double(SILENCE));
+    double envSamples = 0.0;
+    if (p.envRelease > 0.0f && p.envRelease < 1.0f) {
+        envSamples = silence / std::log(double(p.envRelease));
+    }
+    
+//    The filter envelope steps at the LFO rate, every LFO_MAX samples.
+//    It can't outlast the amplitude envelope in practice, but the tail
+//    is better a little too long than cut short.
+    double filterSamples = 0.0;
+    if (p.filterRelease > 0.0f && p.filterRelease < 1.0f) {
+        filterSamples = silence / std::log(double(p.filterRelease)) * Synth::LFO_MAX;
+    }
+    
+    return juce::jmax(envSamples, filterSamples) / sampleRate;
+}
 
-//    Maps the value from 0%-100% to 0-1. Thread-safe operation.
-        float noiseMix = noiseParam->get() / 100.0f;
+SynthParams JX11AudioProcessor::calcSynthParams(const float* values, float sampleRate)
+{
+    SynthParams p;
+    for (int i = 0; i < NUM_PARAMS; ++i) {
+        calcSynthParam(i, values, sampleRate, p);
+    }
+    return p;
+}
+
+void JX11AudioProcessor::calcSynthParam(int index, const float* values, float sampleRate, SynthParams& p)
+{
+//    Scale time values in sec to the corresponding
+//    time values in samples.
+    float inverseSampleRate = 1.0f / sampleRate;
+//    The sample rate for the LFO is 32 times lower than the audio’s sample rate
+    const float inverseUpdateRate = inverseSampleRate * Synth::LFO_MAX;
+    
+    switch (index) {
+//    Noise, Oscillator Mix and the filter resonance
+//    --------------------------------------------------------------------------
+//    All three go into the volume trim, so they're calculated together.
+        case NOISE:
+        case OSC_MIX:
+        case FILTER_RESO: {
+//    Maps the value from 0%-100% to 0-1.
+            float noiseMix = values[NOISE] / 100.0f;
     
 //    Squaring the parameter to become logarithmic. Human hearing.
-        noiseMix *= noiseMix;
+            noiseMix *= noiseMix;
     
 //    The audio rendering happens in class Synth. Times 0.06 sets the
 //    maximum noise level roughly to -24dB for flavoring the sound.
-        synth.noiseMix = noiseMix * 0.06f;
+            p.noiseMix = noiseMix * 0.06f;
+            
+//    Maps the value from 0%-100% to 0-1.
+            p.oscMix = values[OSC_MIX] / 100.0f;
+            
+//    It creates an exponential curve that starts at
+//    filterQ = 1 and goes up to filterQ = 20.
+            float filterReso = values[FILTER_RESO] / 100.0f;
+            p.filterQ = std::exp(3.0f * filterReso);
+    //    Velocity used to be (velocity / 127) * 0.5
+    //    -> 0.5/127 = 0.00394. It's also the value for
+    //    oscMix and noiseMix equals 0. Maximum amplitude of a
+    //    single voice (-6dB).
+        
+    //    oscMix 100%: vT = 0.00384
+    //    -> 20 × log10(0.00264/0.00384) = −3.25dB. Two waveforms with
+    //    the same amplitude. Therefore, a decrease by -3dB.
+        
+    //    oscMix and noiseMix 100%: vt = 0.00084 -> -13dB
+    //    Noise makes the perceived sound louder due to more freqs.
+            p.volumeTrim =
+            0.0008f * (3.2f - p.oscMix - 25.0f * p.noiseMix) * (1.5f - 0.5f * filterReso);
+            break;
+        }
 //    --------------------------------------------------------------------------
 
 //    Envelope
 //    --------------------------------------------------------------------------
 
-//    Actual sample rate
-    float sampleRate = float(getSampleRate());
-    
 //    First version
     
 //    EnvDecay param measures in 0-100%. Conversion to 0-1.
 //    This example defies the decay time of 100% at 5 sec.
-//    float decayTime = envDecayParam->get() / 100.0f * 5.0f;
+//    float decayTime = values[ENV_DECAY] / 100.0f * 5.0f;
 //    In the digital audio domain time is measured in samples.
 //    For instance, a sampleRate of 44,1kHz produces in 1 sec
 //    44100 samples. The decayTime is a multiplier for time
@@ -403,44 +907,45 @@ void JX11AudioProcessor::update()
 //    0 (SILENCE) in a certain amount of time.
 //    Due to the human hearing the lower
 //    threshold is expressed in dB.
-//    synth.envDecay = std::exp(std::log(SILENCE) / decaySamples);
+//    p.envDecay = std::exp(std::log(SILENCE) / decaySamples);
     
 //    Actual second version
-    
-//    Scale time values in sec to the corresponding
-//    time values in samples.
-    float inverseSampleRate = 1.0f / sampleRate;
-    
-    
-    synth.envAttack =
-        std::exp(-inverseSampleRate * std::exp(5.5f - 0.075f * envAttackParam->get()));
-    
-    synth.envDecay =
-        std::exp(-inverseSampleRate * std::exp(5.5f - 0.075f * envDecayParam->get()));
-    
-    synth.envSustain = envSustainParam->get() / 100.0f;
-    
-    float envRelease = envReleaseParam->get();
-    
-    if (envRelease < 1.0f) {
-        synth.envRelease = 0.75f; // extra fast release
-    }
-    else {
-        synth.envRelease = std::exp(-inverseSampleRate * std::exp(5.5f - 0.075f * envRelease));
-    }
+        case ENV_ATTACK:
+            p.envAttack =
+                std::exp(-inverseSampleRate * std::exp(5.5f - 0.075f * values[ENV_ATTACK]));
+            break;
+    
+        case ENV_DECAY:
+            p.envDecay =
+                std::exp(-inverseSampleRate * std::exp(5.5f - 0.075f * values[ENV_DECAY]));
+            break;
+    
+        case ENV_SUSTAIN:
+            p.envSustain = values[ENV_SUSTAIN] / 100.0f;
+            break;
+    
+        case ENV_RELEASE: {
+            float envRelease = values[ENV_RELEASE];
+    
+            if (envRelease < 1.0f) {
+                p.envRelease = 0.75f; // extra fast release
+            }
+            else {
+                p.envRelease = std::exp(-inverseSampleRate * std::exp(5.5f - 0.075f * envRelease));
+            }
+            break;
+        }
 //    --------------------------------------------------------------------------
 
-//    Oscillator Mix
+//    Oscillator detune
 //    --------------------------------------------------------------------------
-
-//    Maps the value from 0%-100% to 0-1. Thread-safe operation.
-    synth.oscMix = oscMixParam->get() / 100.0f;
-    
+        case OSC_TUNE:
+        case OSC_FINE: {
 //    Detuning the second oscillator
 //    by cents and half steps.
-    float semi = oscTuneParam->get();
+            float semi = values[OSC_TUNE];
 //    A cent is 1/100th of a semitone
-    float cent = oscFineParam->get();
+            float cent = values[OSC_FINE];
     
 //    Same as
 //    float freq = 440.0f * std::exp2(float(note - 69) / 12.0f)
@@ -448,32 +953,39 @@ void JX11AudioProcessor::update()
 //    semi + cent/100 gets the total amount of semitones. Prefer
 //    multiplying versions due to processing. The negative
 //    algebraic sign results in the vice versa tuning of the pitch.
-    synth.detune = std::pow(1.059463094359f, -semi - 0.01f * cent);
+            p.detune = std::pow(1.059463094359f, -semi - 0.01f * cent);
+            break;
+        }
 //    --------------------------------------------------------------------------
     
 //    Overall Tuning
 //    --------------------------------------------------------------------------
-    
+        case OCTAVE:
+        case TUNING: {
 //    2 octaves up or down
-    float octave = octaveParam->get();
+            float octave = values[OCTAVE];
 //    –100 to +100 cents
-    float tuning = tuningParam->get();
-    float tuneInSemi = -36.3763f - 12.0f * octave - tuning / 100.0f;
+            float tuning = values[TUNING];
+            float tuneInSemi = -36.3763f - 12.0f * octave - tuning / 100.0f;
     
 //    12 semitones in an ocatve and 100 cents
 //    in a semitone
-//    synth.tune = octave * 12.0f + tuning * .01f;
+//    p.tune = octave * 12.0f + tuning * .01f;
     
 //    New method:
 //    It combines the sample rate, the tuning in octaves and cents,
 //    and the reference pitch of 8.1758 Hz, into a single number.
-    synth.tune = sampleRate * std::exp(0.05776226505f * tuneInSemi);
+            p.tune = sampleRate * std::exp(0.05776226505f * tuneInSemi);
+            break;
+        }
 //    --------------------------------------------------------------------------
     
 //    Polyphony
 //    --------------------------------------------------------------------------
 //    Choice of polyphony (Synth::MAX_VOICES) or not (1)
-    synth.numVoices = (polyModeParam->getIndex() == 0) ? 1 : Synth::MAX_VOICES;
+        case POLY_MODE:
+            p.numVoices = (juce::roundToInt(values[POLY_MODE]) == 0) ? 1 : Synth::MAX_VOICES;
+            break;
 //    --------------------------------------------------------------------------
 //    Volume
 //    --------------------------------------------------------------------------
@@ -481,108 +993,121 @@ void JX11AudioProcessor::update()
     
 
     
-//    Total volume
-//    Does a linear interpolation over 0.05 seconds from the
-//    current value to this new target.
-    synth.outputLevelSmoother.setTargetValue(juce::Decibels::decibelsToGain(outputLevelParam->get()));
+//    Total volume as a gain. Synth smooths it
+//    on its way to this new target.
+        case OUTPUT_LEVEL:
+            p.outputLevel = juce::Decibels::decibelsToGain(values[OUTPUT_LEVEL]);
+            break;
 
 //    --------------------------------------------------------------------------
 //    Modulation (Sensitivity, LFO, Vibrato, PWM, Glide)
 //    --------------------------------------------------------------------------
             /*    Velocity sensitivity  */
-    float filterVelocity = filterVelocityParam->get();
+        case FILTER_VELOCITY: {
+            float filterVelocity = values[FILTER_VELOCITY];
 //    Changes the dynamic range of the sound to 0 dB
-    if (filterVelocity < -90.0f) {
+            if (filterVelocity < -90.0f) {
 //        Sets ignoreVelocity to true when the parameter says OFF. 
-        synth.velocitySensitivity = 0.0f;
-        synth.ignoreVelocity = true;
-    } else {
-        synth.velocitySensitivity = 0.0005f * filterVelocity;
-        synth.ignoreVelocity = false;
-    }
+                p.velocitySensitivity = 0.0f;
+                p.ignoreVelocity = true;
+            } else {
+                p.velocitySensitivity = 0.0005f * filterVelocity;
+                p.ignoreVelocity = false;
+            }
+            break;
+        }
     
             /*    LFO   */
-//    The sample rate for the LFO is 32 times lower than the audio’s sample rate
-    const float inverseUpdateRate = inverseSampleRate * synth.LFO_MAX;
+        case LFO_RATE: {
 //    Sets the frequency.
 //    Maps 0 – 1 parameter value to 0.0183 Hz – 20.086 Hz, or roughly 0.02 Hz to 20 Hz.
-    float lfoRate = std::exp(7.0f * lfoRateParam->get() - 4.0f);
+            float lfoRate = std::exp(7.0f * values[LFO_RATE] - 4.0f);
 //    inc = freq / sampleRate
-    synth.lfoInc = lfoRate * inverseUpdateRate * float(TWO_PI);
+            p.lfoInc = lfoRate * inverseUpdateRate * float(TWO_PI);
+            break;
+        }
     
             /*    Vibrato/PWM  */
+        case VIBRATO: {
 //    The Vibrato parameter goes between –100% and +100%.
-    float vibrato = vibratoParam->get() / 200.0f;
+            float vibrato = values[VIBRATO] / 200.0f;
 //    Vibrato is a parabolic curve from 0% (0) to 100% (0.05).
-    synth.vibrato = .2f * vibrato * vibrato;
-//    Sets the new pwmDepth variable to the value of synth.vibrato.
-    synth.pwmDepth = synth.vibrato;
-    if (vibrato < 0.0f) {
+            p.vibrato = .2f * vibrato * vibrato;
+//    Sets the new pwmDepth variable to the value of p.vibrato.
+            p.pwmDepth = p.vibrato;
+            if (vibrato < 0.0f) {
 //        If vibrato is negative,
 //        PWM mode should be used instead of the vibrato effect.
 //        Turning off regular vibrato:
-        synth.vibrato = 0.0f;
-    }
+                p.vibrato = 0.0f;
+            }
+            break;
+        }
     
             /*   Glide   */
     
 //    0=off, 1=legato-style, 2=always
-    synth.glideMode = glideModeParam->getIndex();
+        case GLIDE_MODE:
+            p.glideMode = juce::roundToInt(values[GLIDE_MODE]);
+            break;
     
 //    glide speed as a percentage. glideRate as
 //    coefficient for one-pole filter.
-    float glideRate = glideRateParam->get();
-    if (glideRate < 2.0f) {
-        synth.glideRate = 1.0f;
-    } else {
-        synth.glideRate = 1.0f - std::exp(-inverseUpdateRate * std::exp(6.0f - 0.07f * glideRate));
-    }
+        case GLIDE_RATE: {
+            float glideRate = values[GLIDE_RATE];
+            if (glideRate < 2.0f) {
+                p.glideRate = 1.0f;
+            } else {
+                p.glideRate = 1.0f - std::exp(-inverseUpdateRate * std::exp(6.0f - 0.07f * glideRate));
+            }
+            break;
+        }
     
 //    Range: 36 semitones to +36 semitones.
-    synth.glideBend = glideBendParam->get();
+        case GLIDE_BEND:
+            p.glideBend = values[GLIDE_BEND];
+            break;
     
 //    --------------------------------------------------------------------------
 //    Filter
 //    --------------------------------------------------------------------------
 //    Converting the percentage from 0 – 100% into the range –1.5 to 6.5.
 //    The lower, the more sound get filtered.
-    synth.filterKeyTracking = 0.08f * filterFreqParam->get() - 1.5f;
-    
-//    It creates an exponential curve that starts at
-//    filterQ = 1 and goes up to filterQ = 20.
-    float filterReso = filterResoParam->get() / 100.0f;
-    synth.filterQ = std::exp(3.0f * filterReso);
-    //    Velocity used to be (velocity / 127) * 0.5
-    //    -> 0.5/127 = 0.00394. It's also the value for
-    //    oscMix and noiseMix equals 0. Maximum amplitude of a
-    //    single voice (-6dB).
-        
-    //    oscMix 100%: vT = 0.00384
-    //    -> 20 × log10(0.00264/0.00384) = −3.25dB. Two waveforms with
-    //    the same amplitude. Therefore, a decrease by -3dB.
-        
-    //    oscMix and noiseMix 100%: vt = 0.00084 -> -13dB
-    //    Noise makes the perceived sound louder due to more freqs.
-        synth.volumeTrim =
-        0.0008f * (3.2f - synth.oscMix - 25.0f * synth.noiseMix) * (1.5f - 0.5f * filterReso);
+        case FILTER_FREQ:
+            p.filterKeyTracking = 0.08f * values[FILTER_FREQ] - 1.5f;
+            break;
     
-    float filterLFO = filterLFOParam->get() / 100.0f;
+        case FILTER_LFO: {
+            float filterLFO = values[FILTER_LFO] / 100.0f;
 //    Possible values go between 0 and 2.5.
-    synth.filterLFODepth = 2.5f * filterLFO * filterLFO;
+            p.filterLFODepth = 2.5f * filterLFO * filterLFO;
+            break;
+        }
     
 //    Filter envelopes
-    synth.filterAttack = std::exp(-inverseUpdateRate *
-                                    std::exp(5.5f - 0.075f * filterAttackParam->get()));
-    synth.filterDecay = std::exp(-inverseUpdateRate *
-                                    std::exp(5.5f - 0.075f * filterDecayParam->get()));
-    float filterSustain = filterSustainParam->get() / 100.0f;
-    synth.filterSustain = filterSustain * filterSustain;
-    synth.filterRelease = std::exp(-inverseUpdateRate *
-                                    std::exp(5.5f - 0.075f * filterReleaseParam->get()));
+        case FILTER_ATTACK:
+            p.filterAttack = std::exp(-inverseUpdateRate *
+                                            std::exp(5.5f - 0.075f * values[FILTER_ATTACK]));
+            break;
+        case FILTER_DECAY:
+            p.filterDecay = std::exp(-inverseUpdateRate *
+                                            std::exp(5.5f - 0.075f * values[FILTER_DECAY]));
+            break;
+        case FILTER_SUSTAIN: {
+            float filterSustain = values[FILTER_SUSTAIN] / 100.0f;
+            p.filterSustain = filterSustain * filterSustain;
+            break;
+        }
+        case FILTER_RELEASE:
+            p.filterRelease = std::exp(-inverseUpdateRate *
+                                            std::exp(5.5f - 0.075f * values[FILTER_RELEASE]));
+            break;
 //    Intensity of the envelope modulation.
 //    Range from –100% to 100% mapping to –6.0 and +6.0.
-    synth.filterEnvDepth = 0.06f * filterEnvParam->get();
-
+        case FILTER_ENV:
+            p.filterEnvDepth = 0.06f * values[FILTER_ENV];
+            break;
+    }
 }
 //==============================================================================
 
@@ -590,6 +1115,13 @@ void JX11AudioProcessor::splitBufferByEvents(juce::AudioBuffer<float>& buffer, j
 {
     int bufferOffset = 0;
     
+//    The editor's events happened some time during the last
+//    block, so they all go to the start of this one.
+    for (int i = 0; i < numEditorEvents; ++i) {
+        handleMIDI(editorEvents[size_t(i)]);
+    }
+    numEditorEvents = 0;
+    
     for (const auto metadata : midiMessages) {
 //        Render the audio that happens before this event (if any).
         int samplesThisSegment = metadata.samplePosition - bufferOffset;
@@ -599,12 +1131,10 @@ void JX11AudioProcessor::splitBufferByEvents(juce::AudioBuffer<float>& buffer, j
         }
         
 //        Handle the event. Ignore MIDI messages such as sysex.
-        if (metadata.numBytes <= 3) {
-            juce::MidiMessage midiMessage = metadata.getMessage();
-            uint8_t data1 = (midiMessage.getRawDataSize() >= 2) ? midiMessage.getRawData()[1] : 0;
-            uint8_t data2 = (midiMessage.getRawDataSize() == 3) ? midiMessage.getRawData()[2] : 0;
-            handleMIDI(midiMessage.getRawData()[0], data1, data2);
-            
+//        The bytes are read in place, without a juce::MidiMessage.
+        MidiEvent event = midiDecoder.decode(metadata.data, metadata.numBytes);
+        if (event.status != 0) {
+            handleMIDI(event);
         }
     }
     
@@ -618,31 +1148,115 @@ void JX11AudioProcessor::splitBufferByEvents(juce::AudioBuffer<float>& buffer, j
     midiMessages.clear();
 }
 
-void JX11AudioProcessor::handleMIDI(uint8_t data0, uint8_t data1, uint8_t data2)
+void JX11AudioProcessor::handleMIDI(const MidiEvent& event)
 {
 //    Checks if midiLearn is true and for
 //    command Control Change.
-    if (midiLearn && ((data0 & 0xF0) == 0xB0)) {
-        DBG("learned a MIDI CC");
-//        Using the CC number (in data1) from
-//        the message (data1).
-        midiLearnCC = data1;
+    if (midiLearn && event.status == 0xB0) {
+        log.write(RealtimeLog::midiCCLearned, 0, float(event.index));
+//        Using the CC number from the message. The timer
+//        puts it into the map on the message thread.
+        learnedCC = event.index;
         midiLearn = false;
         return;
     }
     
+//    A mapped controller drives its parameter instead of doing what
+//    it normally does. With MPE, only the master channel is looked
+//    at, the other channels use CC 74 for the timbre of their note.
+    if (event.status == 0xB0 && midiMapping != nullptr
+        && (!mpe.load() || event.channel == 0)
+        && !(multiTimbralActive && event.channel > 0)) {
+        const MidiMapping& mapping = (*midiMapping)[event.index];
+        if (mapping.param >= 0) {
+            midiControl(mapping, event);
+            return;
+        }
+    }
+    
+//    In multi-timbral mode, channels 2 to 16 go to their parts.
+    if (multiTimbralActive && event.channel > 0) {
+        handlePartMIDI(event.channel - 1, event);
+        return;
+    }
+    
 //    Program Change
 //    Checks if the command is 0xC,
 //    which is Program Change.
-    if ((data0 & 0xF0) == 0xC0) {
-//        data1 byte contains the number of the program.
-        if (data1 < presets.size()) {
-            setCurrentProgram(data1);
-        } 
+    if (event.status == 0xC0) {
+//        index contains the number of the program.
+//        Loading the program is not real-time safe. The message
+//        thread picks up the request and calls setCurrentProgram().
+        if (event.index < NUM_PRESETS) {
+            pendingProgram.store(event.index);
+        }
     }
     
 //    Outputs a sound by pressing MIDI keyboard
-    synth.midiMessage(data0, data1, data2);
+    engines[activeEngine].midiEvent(event);
+}
+
+void JX11AudioProcessor::midiControl(const MidiMapping& mapping, const MidiEvent& event)
+{
+    int i = mapping.param;
+    float value = juce::jlimit(0.0f, 1.0f, mapping.apply(event.unipolar()));
+    
+//    The first move starts from where the parameter is.
+    if (!ccActive[i]) {
+        ccSmoothers[i].setCurrentAndTargetValue(params[i]->getValue());
+        ccActive[i] = true;
+    }
+    
+//    Choices such as Glide Mode switch at once.
+    if (params[i]->isDiscrete()) {
+        ccSmoothers[i].setCurrentAndTargetValue(value);
+    } else {
+        ccSmoothers[i].setTargetValue(value);
+    }
+    ccPendingValue[i].store(value);
+}
+
+bool JX11AudioProcessor::advanceMidiControl(int numSamples)
+{
+    bool controlled = false;
+    for (int i = 0; i < NUM_PARAMS; ++i) {
+        if (!ccActive[i]) {
+            continue;
+        }
+        controlled = true;
+        if (ccSmoothers[i].isSmoothing()) {
+            ccSmoothers[i].skip(numSamples);
+        } else if (ccPendingValue[i].load() < 0.0f) {
+//            The parameter has the value now and takes over again.
+            ccActive[i] = false;
+        }
+    }
+    return controlled;
+}
+
+void JX11AudioProcessor::handlePartMIDI(int part, const MidiEvent& event)
+{
+//    A Program Change gives the part a factory preset. Unlike the
+//    main sound, this touches no parameters and needs no message
+//    thread: only the values of the part are calculated.
+    if (event.status == 0xC0) {
+        if (event.index < NUM_PRESETS) {
+            partPrograms[size_t(part)].store(event.index);
+            updateParts(false);
+        }
+        return;
+    }
+    parts[size_t(part)].midiEvent(event);
+}
+
+bool JX11AudioProcessor::arePartsPlaying() const
+{
+    for (const auto& part : parts) {
+        if (part.isPlaying()) {
+            return true;
+        }
+    }
+    return false;
 }
 
 void JX11AudioProcessor::render(
@@ -653,14 +1267,142 @@ void JX11AudioProcessor::render(
     
 //    Get a pointer to the audio data inside (getWritePointer)
 //    AudioBuffer is split up due to MIDI time stamps
-//    bufferOffset is the actual start of the buffer
-    outputBuffers[0] = buffer.getWritePointer(0) + bufferOffset;
+//    bufferOffset is the actual start of the buffer.
+//    The main output is always enabled.
+    getOutputBuffers(buffer, 0, bufferOffset, outputBuffers);
     
-    if (getTotalNumInputChannels() > 1) {
-        outputBuffers[1] = buffer.getWritePointer(1) + bufferOffset;
+    engines[activeEngine].render(outputBuffers, sampleCount);
+    
+    renderParts(buffer, outputBuffers, sampleCount, bufferOffset);
+    
+    if (fadingEngine >= 0) {
+        renderCrossfade(outputBuffers, sampleCount);
     }
+}
+
+bool JX11AudioProcessor::getOutputBuffers(juce::AudioBuffer<float>& buffer, int busIndex,
+                                          int bufferOffset, float** outputBuffers)
+{
+    outputBuffers[0] = nullptr;
+    outputBuffers[1] = nullptr;
     
-    synth.render(outputBuffers, sampleCount);
+    auto* bus = getBus(false, busIndex);
+    if (bus == nullptr || !bus->isEnabled()) {
+        return false;
+    }
+    
+//    A synth has no inputs, so the channels of the bus
+//    are found among the outputs. Mono if the host
+//    only gives the bus one channel.
+    int channel = bus->getChannelIndexInProcessBlockBuffer(0);
+    outputBuffers[0] = buffer.getWritePointer(channel) + bufferOffset;
+    if (bus->getNumberOfChannels() > 1) {
+        outputBuffers[1] = buffer.getWritePointer(channel + 1) + bufferOffset;
+    }
+    return true;
+}
+
+void JX11AudioProcessor::renderParts(juce::AudioBuffer<float>& buffer, float** outputBuffers,
+                                     int sampleCount, int bufferOffset)
+{
+//    Parts without notes cost nothing, so the work
+//    grows with the notes played, not with the parts.
+    for (size_t i = 0; i < parts.size(); ++i) {
+        Synth& part = parts[i];
+        
+//        A part with an output of its own renders straight into it.
+//        Silence is written only to outputs the host has enabled.
+        float* partOutput[2];
+        if (getOutputBuffers(buffer, int(i) + 1, bufferOffset, partOutput)) {
+            if (part.isPlaying()) {
+                part.render(partOutput, sampleCount);
+            } else {
+                for (auto* output : partOutput) {
+                    if (output != nullptr) {
+                        juce::FloatVectorOperations::clear(output, sampleCount);
+                    }
+                }
+            }
+            continue;
+        }
+        
+        if (!part.isPlaying()) {
+            continue;
+        }
+        
+//        Rendered in chunks that fit into partBuffer,
+//        the same as the crossfade.
+        int offset = 0;
+        while (offset < sampleCount) {
+            int chunk = juce::jmin(sampleCount - offset, partBuffer.getNumSamples());
+            if (chunk <= 0) {
+                break;
+            }
+            
+            float* partBuffers[2] = { partBuffer.getWritePointer(0), nullptr };
+            if (outputBuffers[1] != nullptr) {
+                partBuffers[1] = partBuffer.getWritePointer(1);
+            }
+            part.render(partBuffers, chunk);
+            
+            for (int channel = 0; channel < 2; ++channel) {
+                if (outputBuffers[channel] != nullptr) {
+                    juce::FloatVectorOperations::add(outputBuffers[channel] + offset,
+                                                     partBuffers[channel], chunk);
+                }
+            }
+            offset += chunk;
+        }
+    }
+}
+
+void JX11AudioProcessor::renderCrossfade(float** outputBuffers, int sampleCount)
+{
+    Synth& oldSynth = engines[fadingEngine];
+    
+//    The host may send more samples than announced in
+//    prepareToPlay(), so the old engine renders in chunks
+//    that fit into crossfadeBuffer.
+    int offset = 0;
+    while (offset < sampleCount) {
+        int chunk = juce::jmin(sampleCount - offset,
+                               crossfadeBuffer.getNumSamples(),
+                               crossfadeRemaining);
+        if (chunk <= 0) {
+            break;
+        }
+        
+        float* fadeBuffers[2] = { crossfadeBuffer.getWritePointer(0), nullptr };
+        if (outputBuffers[1] != nullptr) {
+            fadeBuffers[1] = crossfadeBuffer.getWritePointer(1);
+        }
+        oldSynth.render(fadeBuffers, chunk);
+        
+//        Linear fade out of the old engine. The new engine started
+//        without any voices, so it doesn't need a fade in. Its new
+//        notes have their own attack.
+        for (int channel = 0; channel < 2; ++channel) {
+            if (outputBuffers[channel] == nullptr) {
+                continue;
+            }
+            float* output = outputBuffers[channel] + offset;
+            const float* fade = fadeBuffers[channel];
+            for (int i = 0; i < chunk; ++i) {
+                float gain = float(crossfadeRemaining - i) / float(crossfadeLength);
+                output[i] += fade[i] * gain;
+            }
+        }
+        
+        crossfadeRemaining -= chunk;
+        offset += chunk;
+    }
+    
+//    The old engine is skipped from now on, either because the
+//    fade is over or because all of its notes have died out.
+    if (crossfadeRemaining <= 0 || !oldSynth.isPlaying()) {
+        fadingEngine = -1;
+        crossfadeRemaining = 0;
+    }
 }
 
 //==============================================================================
@@ -686,39 +1428,196 @@ juce::AudioProcessorEditor* JX11AudioProcessor::createEditor()
 //==============================================================================
 void JX11AudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-//    Creates a new XML element with a tag name
-//    to store the state.
-    auto xml = std::make_unique<juce::XmlElement>(pluginTag);
-    
-//    The current state of the parameters (stored in apvts) is copied
-//    and converted into an XML format.
-    std::unique_ptr<juce::XmlElement> parametersXML(apvts.copyState().createXml());
-//    The parameters XML is added as a child element
-//    to the main XML element.
-    xml->addChildElement(parametersXML.release());
-    
-//    Creates a new XML element with a tag name
-//    to store the MIDI CC Number.
-    auto extraXML = std::make_unique<juce::XmlElement>(extraTag);
-//    Gives it an attribute named midiCC with the value of the
-//    MIDI CC code that the user has learned (or the default 0x47).
-    extraXML->setAttribute(midiCCAttribute, midiLearnCC);
-    xml->addChildElement(extraXML.release());
-
+    JX11_ASSERT_NOT_REALTIME("getStateInformation()");
+    
+//    The state is a small binary chunk instead of XML:
+//    magic number, version, number of parameters, the parameter
+//    values in the order of Preset::param and then the extras.
+//    Saving and loading it doesn't need to build or parse
+//    an XML tree, which adds up in projects with many instances.
+    juce::MemoryOutputStream stream(destData, false);
+    stream.writeInt(stateMagic);
+    stream.writeInt(stateVersion);
+    stream.writeInt(NUM_PARAMS);
+    
+//    Real parameter values, not the normalised 0 - 1 values.
+    for (int i = 0; i < NUM_PARAMS; ++i) {
+        stream.writeFloat(params[i]->convertFrom0to1(params[i]->getValue()));
+    }
     
-//    The entire XML structure is converted into a
-//    binary format and stored in destData
-//    (a juce::MemoryBlock).
-    copyXmlToBinary(*xml, destData);
+//    Extras: the MIDI CC number on Filter Reso and the selected program.
+//    Version 1 could only learn that one controller, so older versions
+//    still find it here. 0x80 means none.
+    auto table = midiMap.get();
+    int resoCC = 0x80;
+    for (int cc = 0; cc < MidiLearnMap::NUM_CC; ++cc) {
+        if (table[size_t(cc)].param == FILTER_RESO) {
+            resoCC = cc;
+            break;
+        }
+    }
+    stream.writeByte(char(resoCC));
+    stream.writeInt(currentProgram);
+    
+//    Multi-timbral mode and the program of each part.
+    stream.writeBool(multiTimbral.load());
+    stream.writeInt(int(partPrograms.size()));
+    for (const auto& program : partPrograms) {
+        stream.writeInt(program.load());
+    }
+    stream.writeBool(mpe.load());
     
-//    Outputs the XML as a string to the debug console.
-    DBG(xml->toString());
+//    The MIDI learn table, only the controllers that are mapped.
+    int numMapped = 0;
+    for (const auto& mapping : table) {
+        numMapped += (mapping.param >= 0) ? 1 : 0;
+    }
+    stream.writeInt(numMapped);
+    for (int cc = 0; cc < MidiLearnMap::NUM_CC; ++cc) {
+        const auto& mapping = table[size_t(cc)];
+        if (mapping.param >= 0) {
+            stream.writeByte(char(cc));
+            stream.writeByte(char(mapping.param));
+            stream.writeFloat(mapping.min);
+            stream.writeFloat(mapping.max);
+            stream.writeByte(char(mapping.curve));
+        }
+    }
     
+    stream.writeBool(limiterEnabled.load());
+    
+//    The morph position, which is a parameter of its own outside
+//    Preset::param, and the end points it blends between.
+    stream.writeFloat(morphParam->get());
+    for (int slot = 0; slot < 2; ++slot) {
+        stream.writeBool(morphTargetSet[slot]);
+        if (morphTargetSet[slot]) {
+            for (float value : morphTargets[slot]) {
+                stream.writeFloat(value);
+            }
+        }
+    }
+}
+
+//Sets a parameter from a saved real value. Only a value that changes
+//is set and sent on to the listeners (the host, the attachments and the
+//apvts state). setValueNotifyingHost() on every parameter would send
+//each one of every instance to the host while a project loads, most
+//of them with the value the parameter already has.
+static void loadParameter(juce::RangedAudioParameter& param, float value)
+{
+    float normalised = param.convertTo0to1(value);
+    if (normalised != param.getValue()) {
+        param.setValue(normalised);
+        param.sendValueChangedMessageToListeners(normalised);
+    }
 }
 
 void JX11AudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
+    JX11_ASSERT_NOT_REALTIME("setStateInformation()");
+    
+    juce::MemoryInputStream stream(data, size_t(juce::jmax(0, sizeInBytes)), false);
+    
+//    Magic, version and number of parameters.
+    if (sizeInBytes >= 12 && stream.readInt() == stateMagic) {
+        int version = stream.readInt();
+        int numParams = stream.readInt();
+//        A state from a newer JX11 may store its extras differently,
+//        so it's left alone rather than read wrongly.
+        if (version < 1 || version > stateVersion || numParams < 0 || numParams > NUM_PARAMS) {
+            return;
+        }
+        
+//        A state saved with fewer parameters keeps the
+//        current values for the missing ones.
+        for (int i = 0; i < numParams; ++i) {
+            loadParameter(*params[i], stream.readFloat());
+        }
+        
+//        Sections that came in during version 1 or 2 without a new
+//        version are only in the later states of that version, so
+//        there they're read if the data goes on.
+        auto hasSection = [&](int since) {
+            return version >= since;
+        };
+        auto hasSectionAddedIn = [&](int addedIn) {
+            return version > addedIn || (version == addedIn && !stream.isExhausted());
+        };
+        
+        if (hasSection(1)) {
+            int resoCC = static_cast<uint8_t>(stream.readByte());
+            if (version < 2) {
+                setLegacyMidiCC(resoCC);
+            }
+            int program = stream.readInt();
+            if (program >= 0 && program < getNumPrograms()) {
+                currentProgram = program;
+            }
+        }
+        if (hasSectionAddedIn(1)) {
+            multiTimbral = stream.readBool();
+            int numParts = hasSection(4) ? stream.readInt() : int(partPrograms.size());
+            for (int part = 0; part < int(partPrograms.size()); ++part) {
+                int program = (part < numParts) ? stream.readInt() : -1;
+                partPrograms[size_t(part)].store((program >= 0 && program < NUM_PRESETS) ? program : -1);
+            }
+//            Parts from a version with more of them are skipped.
+            for (int part = int(partPrograms.size()); part < numParts && !stream.isExhausted(); ++part) {
+                stream.readInt();
+            }
+        }
+        if (hasSectionAddedIn(1)) {
+            mpe = stream.readBool();
+        }
+        if (hasSection(2)) {
+            MidiLearnMap::Table table;
+            int numMapped = stream.readInt();
+            for (int i = 0; i < numMapped && !stream.isExhausted(); ++i) {
+                int cc = static_cast<uint8_t>(stream.readByte());
+                int param = static_cast<uint8_t>(stream.readByte());
+                float min = stream.readFloat();
+                float max = stream.readFloat();
+                int curve = static_cast<uint8_t>(stream.readByte());
+                if (cc < MidiLearnMap::NUM_CC && param < NUM_PARAMS) {
+                    auto& mapping = table[size_t(cc)];
+                    mapping.param = param;
+                    mapping.min = juce::jlimit(0.0f, 1.0f, min);
+                    mapping.max = juce::jlimit(0.0f, 1.0f, max);
+                    mapping.curve = uint8_t((curve <= MidiMapping::logarithmic) ? curve : MidiMapping::linear);
+                }
+            }
+            midiMap.set(table);
+        }
+        if (hasSectionAddedIn(2)) {
+            setLimiterEnabled(stream.readBool());
+        }
+        if (hasSection(3)) {
+            loadParameter(*morphParam, stream.readFloat());
+            
+            clearMorph();
+            for (int slot = 0; slot < 2 && !stream.isExhausted(); ++slot) {
+                if (stream.readBool()) {
+                    for (float& value : morphTargets[slot]) {
+                        value = stream.readFloat();
+                    }
+                    morphTargetSet[slot] = true;
+                }
+            }
+            buildMorphTable();
+        }
+        
+//        Signal processBlock() to call update() again.
+        parametersChanged.store(true);
+        return;
+    }
     
+//    Older versions of JX11 saved the state as XML.
+    setStateFromXml(data, sizeInBytes);
+}
+
+void JX11AudioProcessor::setStateFromXml(const void* data, int sizeInBytes)
+{
 //    Parse binary data into an xml document.
 //    Converts the binary data back into an XML structure.
     std::unique_ptr<juce::XmlElement> xml(getXmlFromBinary(data, sizeInBytes));
@@ -739,12 +1638,21 @@ void JX11AudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 //            This looks for the <EXTRA midiCC="..."/> element,
 //            reads the attribute..
             int midiCC = extraXML->getIntAttribute(midiCCAttribute);
-//            ...and puts it into midiLearnCC.
-            midiLearnCC = static_cast<uint8_t>(midiCC);
+//            ...and maps it to Filter Reso.
+            setLegacyMidiCC(midiCC);
         }
     }
 }
 
+void JX11AudioProcessor::setLegacyMidiCC(int cc)
+{
+    MidiLearnMap::Table table;
+    if (cc >= 0 && cc < MidiLearnMap::NUM_CC) {
+        table[size_t(cc)].param = FILTER_RESO;
+    }
+    midiMap.set(table);
+}
+
 //==============================================================================
 // This creates new instances of the plugin..
 juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
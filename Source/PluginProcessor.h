@@ -11,6 +11,13 @@
 #include <JuceHeader.h>
 #include "Synth.h"
 #include "Preset.h"
+#include "SharedResources.h"
+#include "AudioScope.h"
+#include "VoiceMonitor.h"
+#include "MidiLearn.h"
+#include "MidiEventQueue.h"
+#include "RealtimeCheck.h"
+#include "OutputStage.h"
 
 //  juce::ParameterID is a parameter identifier that
 //  combines a juce::String object with a version number
@@ -46,6 +53,7 @@ namespace ParameterID {
     PARAMETER_ID(tuning)
     PARAMETER_ID(outputLevel)
     PARAMETER_ID(polyMode)
+    PARAMETER_ID(morph)
     #undef PARAMETER_ID
 }
 
@@ -56,12 +64,45 @@ class JX11AudioProcessor  : public juce::AudioProcessor,
                             // Listens to parameter changes.
                             // Only changes when the value alters.
                             // It prevents unecessary computing.
-                            private juce::ValueTree::Listener
+                            private juce::ValueTree::Listener,
+                            // Picks up requests from the audio thread
+                            // that must be handled on the message thread.
+                            private juce::Timer
 {
 public:
 //    Determing whether the plug-in is
 //    currently in learning mode or not.
     std::atomic<bool> midiLearn;
+    
+//    Starts MIDI learn. The next Control Change is mapped to the
+//    parameter that is moved after this, or to Filter Reso if none is.
+    void startMidiLearn();
+    
+//    If true, a preset change lets the notes that are still
+//    playing ring out and fades them out, instead of cutting
+//    them off with a reset.
+    std::atomic<bool> presetCrossfade {true};
+    
+//    Multi-timbral mode. MIDI channel 1 plays the main sound, the
+//    one the knobs and the host edit. Channels 2 to 16 each play a
+//    part of their own. Off: all channels play the main sound.
+    std::atomic<bool> multiTimbral {false};
+    
+//    MPE (lower zone): channels 2 to 16 carry one note each, with its
+//    own pitch bend, pressure and timbre. Takes priority over the
+//    multi-timbral mode, since both use the same channels.
+    std::atomic<bool> mpe {false};
+    
+//    Output limiter. Keeps the true peak below -1 dB, at the cost
+//    of about 1.5 ms latency. Without it, the output is only clipped
+//    at 0 dB. Set it with setLimiterEnabled(), which tells the host
+//    about the latency.
+    std::atomic<bool> limiterEnabled {false};
+    void setLimiterEnabled(bool enabled);
+    
+//    Editor setting: draw the editor with OpenGL. Kept here
+//    so it survives closing and reopening the editor.
+    std::atomic<bool> useOpenGL {false};
     //==============================================================================
     JX11AudioProcessor();
     ~JX11AudioProcessor() override;
@@ -108,6 +149,13 @@ public:
 //    This is typically used when loading presets or restoring
 //    the plugin state.
     void setStateInformation (const void* data, int sizeInBytes) override;
+    
+//    Restores a state that was saved as XML by older versions.
+    void setStateFromXml(const void* data, int sizeInBytes);
+    
+//    States before version 2 only have the CC number
+//    that drives Filter Reso.
+    void setLegacyMidiCC(int cc);
     //==============================================================================
 //    AudioProcessorValueTreeState owns the parameters.
 //    Save/restore plug-in state. Eases connection with GUI.
@@ -116,17 +164,73 @@ public:
     
 //    Linking Processor and Editor in order to show the presets in
 //    the customized GUI.
-    const std::vector<Preset>& getPresets() const { return presets; }
     std::vector<std::string> getPresetNames() const;
 //    int getPreset()
+    
+//    The user preset bank, shared with the editor for
+//    listing and searching. Message thread only.
+    PresetLibrary& getUserPresets() { return shared->getUserPresets(); }
+    
+//    Loads record `record` of the user bank.
+    void loadUserPreset(int record);
+    
+//    Adds the current parameter values to the user bank. The
+//    preset can also be found by searching for one of its tags.
+    bool saveUserPreset(const juce::String& name, const juce::StringArray& tags = {});
+    
+//    Output samples for the editor's scope and spectrum.
+    AudioScope& getScope() { return scope; }
+    
+//    Per-voice state for the editor's voice panel.
+    VoiceMonitor& getVoiceMonitor() { return voiceMonitor; }
+    
+//    Notes played on the editor's keyboard.
+    MidiEventQueue& getEditorMidi() { return editorMidi; }
+    
+//    Preset morph. Stores the current sound as end point A (slot 0)
+//    or B (slot 1). Once both are set, the Morph parameter blends
+//    between them and overrides the other parameters until the morph
+//    is cleared or a preset is loaded. Message thread only.
+    void setMorphTarget(int slot);
+    void clearMorph();
+    bool isMorphActive() const { return morphActive; }
 
 private:
     //==============================================================================
-//    Adding the MIDI CC number to the XML.
-//    A roundabout way because Juce doesn't guarantee
-//    that getStateInformation and setStateInformation
-//    will be called on any thread in particular.
-    std::atomic<uint8_t> midiLearnCC;
+//    Which controller drives which parameter. Starts with
+//    CC 71 (0x47) on Filter Reso.
+    MidiLearnMap midiMap;
+    
+//    Audio thread: the table of midiMap, while a block is rendered.
+    const MidiLearnMap::Table* midiMapping = nullptr;
+    
+//    The parameter the next learned controller gets, in the
+//    order of Preset::param.
+    std::atomic<int> midiLearnParam {FILTER_RESO};
+    
+//    A controller that was learned on the audio thread, for the
+//    timer to put into midiMap. -1 means nothing pending.
+    std::atomic<int> learnedCC {-1};
+    
+//    Parameters driven by a controller. The audio thread smooths
+//    the normalised value and uses it right away. The timer then
+//    moves the parameter itself, so the knob and the host follow.
+//    ccPendingValue is -1 once the timer has done that.
+    juce::LinearSmoothedValue<float> ccSmoothers[NUM_PARAMS];
+    bool ccActive[NUM_PARAMS] {};
+    std::atomic<float> ccPendingValue[NUM_PARAMS];
+    
+//    Sets the parameter of a mapped controller. Audio thread.
+    void midiControl(const MidiMapping& mapping, const MidiEvent& event);
+    
+//    Moves the controlled parameters on by a block. Returns true
+//    if any is still controlled, so updateControlled() must run.
+    bool advanceMidiControl(int numSamples);
+    
+//    Recalculates only what depends on the controlled parameters,
+//    instead of all of update(). The timer moves the parameters
+//    themselves a few times per second, and that runs update().
+    void updateControlled();
     
 //    Informs the audio thread (processBlock) about
 //    parameter changes, which are then calculated.
@@ -134,21 +238,137 @@ private:
 //    change, the listener set the atomic variable
 //    true.
     std::atomic<bool> parametersChanged {false};
-    void valueTreePropertyChanged(juce::ValueTree&, const juce::Identifier&) override
+    void valueTreePropertyChanged(juce::ValueTree& tree, const juce::Identifier&) override
     {
+//        The morph position is read directly by processBlock()
+//        and doesn't need a full update().
+        auto id = tree.getProperty("id").toString();
+        if (id == ParameterID::morph.getParamID()) {
+            return;
+        }
+        
+//        In learn mode, the parameter that was moved last is the
+//        one the next controller is mapped to.
+        if (midiLearn) {
+            for (int i = 0; i < NUM_PARAMS; ++i) {
+                if (params[i]->paramID == id) {
+                    midiLearnParam = i;
+                    break;
+                }
+            }
+        }
         parametersChanged.store(true);
     }
     
 //    Calculations to the new parameter values.
     void update();
     
+//    Sends new values to the active engine and to the parts that
+//    follow it, and recalculates the tail length. Audio thread.
+    void applySynthParams(const SynthParams& p);
+    
+//    Turns real parameter values, in the order of Preset::param,
+//    into the values used by Synth. This is where all the std::exp
+//    calls are, so it's the expensive part of update().
+    static SynthParams calcSynthParams(const float* values, float sampleRate);
+//    Only the values in p that depend on the parameter at index.
+    static void calcSynthParam(int index, const float* values, float sampleRate, SynthParams& p);
+    
+//    Audio thread: the real values the main sound was last
+//    calculated from, in the order of Preset::param.
+    float mainValues[NUM_PARAMS] {};
+    
+//    How long the release of a note takes to fall to SILENCE with
+//    these settings. Calculated in update() because it depends on
+//    the parameters, read by getTailLengthSeconds() on any thread.
+    static double calcTailLength(const SynthParams& p, double sampleRate);
+    std::atomic<double> tailLength {0.0};
+    
+//    The longest tail of the main sound and the parts in use,
+//    plus the latency of the limiter if it's on.
+    void updateTailLength();
+    
+//    Morph end points, real values in the order of Preset::param.
+    float morphTargets[2][NUM_PARAMS] {};
+    bool morphTargetSet[2] { false, false };
+    
+//    SynthParams precalculated at MORPH_STEPS + 1 evenly spaced points
+//    from A to B. A morph position between two points blends their
+//    values, which is close enough to the exact curves and much
+//    cheaper than calcSynthParams().
+    static constexpr int MORPH_STEPS = 32;
+    using MorphTable = std::array<SynthParams, MORPH_STEPS + 1>;
+    
+//    Written by the message thread under morphLock. The audio thread
+//    only tries the lock and copies the table into audioMorphTable,
+//    so it never waits for the message thread.
+    MorphTable morphTable;
+    RealtimeCheck::SpinLock morphLock;
+    std::atomic<bool> morphTableChanged {false};
+    std::atomic<bool> morphActive {false};
+    
+//    Only used by the audio thread.
+    MorphTable audioMorphTable;
+    bool hasMorphTable = false;
+    float lastMorph = -1.0f;
+    
+//    Precalculates morphTable from the two end points.
+    void buildMorphTable();
+//    Sends the values at the current morph position to the
+//    active engine, if the position or the table has changed.
+    void updateMorph(bool force);
+    
+//    Program Change messages arrive on the audio thread, but loading
+//    a program notifies the host 26 times and may block. The audio
+//    thread only stores the requested program number here and the
+//    timer loads it on the message thread. -1 means nothing pending.
+    std::atomic<int> pendingProgram {-1};
+    
+//    Set by setCurrentProgram() after the new parameter values are
+//    in place. processBlock() then resets the synth at the start of
+//    the next block, so the swap never happens in the middle of a block.
+    std::atomic<bool> programChanged {false};
+    
+//    Polls pendingProgram on the message thread.
+    void timerCallback() override;
+    
+//    Sets all parameters to the values of a preset.
+//    Used for factory presets and user presets alike.
+    void loadPreset(const Preset& preset);
+    
+//    Presets saved by the user (memory-mapped from disk) and
+//    other things that all instances share.
+    juce::SharedResourcePointer<SharedResources> shared;
+    
+//    Feeds the editor's scope. Does nothing while it's not shown.
+    AudioScope scope;
+    VoiceMonitor voiceMonitor;
+    
+//    Messages from the audio thread, written out by the shared
+//    log thread. Declared after shared, which must outlive it.
+    RealtimeLog log;
+    
+//    Events from the editor. processBlock() takes them out of the
+//    queue at the start of the block and splitBufferByEvents()
+//    handles them before the host's MIDI.
+    MidiEventQueue editorMidi;
+    std::array<MidiEvent, MidiEventQueue::capacity> editorEvents;
+    int numEditorEvents = 0;
+    
     /*
         For MIDI Messages. Splitting the buffer in smaller pieces (p.81)
      */
     void splitBufferByEvents(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages);
-    void handleMIDI(uint8_t data0, uint8_t data1, uint8_t data2);
+    void handleMIDI(const MidiEvent& event);
+//    Turns the incoming MIDI 1.0 bytes into high-resolution events.
+    MidiEventDecoder midiDecoder;
     void render(juce::AudioBuffer<float>& buffer, int sampleCount, int bufferOffset);
     
+//    True when the block can be skipped: no voice is sounding, no
+//    MIDI arrives (from the host or the editor), no crossfade runs,
+//    the output level is steady and the limiter's delay line is empty.
+    bool isIdle(const juce::MidiBuffer& midiMessages) const;
+    
 //    Pointers for each of the 26 parameters
     juce::AudioParameterFloat* oscMixParam;
     juce::AudioParameterFloat* oscTuneParam;
@@ -176,6 +396,11 @@ private:
     juce::AudioParameterFloat* tuningParam;
     juce::AudioParameterFloat* outputLevelParam;
     juce::AudioParameterChoice* polyModeParam;
+    juce::AudioParameterFloat* morphParam;
+    
+//    The same 26 parameters in the order of Preset::param.
+//    Used to load programs and to save/restore the state.
+    juce::RangedAudioParameter* params[NUM_PARAMS];
     
 //    Instantiation of all the AudioParameterFloat
 //    and AudioParameterChoice objects.
@@ -434,17 +659,92 @@ private:
                                                                juce::NormalisableRange<float>(-24.0f, 6.0f, 0.1f),
                                                                0.0f,
                                                                juce::AudioParameterFloatAttributes().withLabel("dB")));
+        
+//        Morph: Blends between the two sounds stored with setMorphTarget().
+//        It isn't part of the presets.
+        layout.add(std::make_unique<juce::AudioParameterFloat>(
+                                                               ParameterID::morph,
+                                                               "Morph",
+                                                               juce::NormalisableRange<float>(0.0f, 100.0f, 0.1f),
+                                                               0.0f,
+                                                               juce::AudioParameterFloatAttributes().withLabel("%")));
 // -------------------------------------------------------------------------------------------------------------------------
 
         return layout;
     }
-//    Synth obeject for rendering audio values
-    Synth synth;
+//    Synth obeject for rendering audio values.
+//    There are two engines for click-free preset switching. The
+//    active engine receives MIDI and parameter changes. After a
+//    preset change the other engine keeps releasing the old notes
+//    while it is faded out.
+    std::array<Synth, 2> engines;
+    int activeEngine = 0;
+    
+//    Index of the engine that is fading out, or -1 if none.
+    int fadingEngine = -1;
+//    Length of the crossfade in samples and how many are left.
+    int crossfadeLength = 0;
+    int crossfadeRemaining = 0;
+//    Output of the fading engine before it is mixed in. Allocated
+//    in prepareToPlay(), so rendering never allocates.
+    juce::AudioBuffer<float> crossfadeBuffer;
+    
+//    Resets only the main sound, both engines, for a program
+//    change. Unlike reset(), the parts keep playing.
+    void resetEngines();
+//    Swaps the engines and starts fading out the old one.
+    void startCrossfade();
+//    Renders the fading engine and mixes it into the output.
+    void renderCrossfade(float** outputBuffers, int sampleCount);
+ 
+//    Multi-timbral parts for MIDI channels 2 to 16. Each part is an
+//    engine with its own voices and its own copy of the settings.
+//    A part follows the main sound until a Program Change on its
+//    channel gives it a factory preset.
+    static constexpr int NUM_PARTS = 16;
+    std::array<Synth, NUM_PARTS - 1> parts;
+    
+//    Factory preset of each part, or -1 to follow the main sound.
+//    Written by the audio thread, saved with the state.
+    std::array<std::atomic<int>, NUM_PARTS - 1> partPrograms;
+    
+//    Audio thread only: the program each part has its settings
+//    from, so a preset is only calculated when it changes.
+    std::array<int, NUM_PARTS - 1> loadedPartPrograms;
+    SynthParams mainParams;
+    bool multiTimbralActive = false;
+    
+//    Audio thread: the tail of the main sound and of each part's
+//    program. A part that follows the main sound has its tail.
+    double mainTail = 0.0;
+    std::array<double, NUM_PARTS - 1> partTails {};
+    
+//    Output of one part before it is mixed in.
+//    Allocated in prepareToPlay().
+    juce::AudioBuffer<float> partBuffer;
+    
+//    Brings the parts up to date with partPrograms. If the main
+//    sound has changed, the parts that follow it get it too.
+    void updateParts(bool mainChanged);
+    void handlePartMIDI(int part, const MidiEvent& event);
+    bool arePartsPlaying() const;
+//    Renders the parts that have notes, into their own output if the
+//    host has enabled it, or else added to the main output.
+    void renderParts(juce::AudioBuffer<float>& buffer, float** outputBuffers,
+                     int sampleCount, int bufferOffset);
+    
+//    The main output is bus 0, the output of part i is bus i + 1.
+    static BusesProperties createBusesProperties();
+//    Points outputBuffers at the channels of an output bus,
+//    or returns false if the bus is disabled.
+    bool getOutputBuffers(juce::AudioBuffer<float>& buffer, int busIndex,
+                          int bufferOffset, float** outputBuffers);
+    
+//    Ear protection and limiter, one per output bus.
+    std::array<OutputStage, NUM_PARTS> outputStages;
+    bool limiterActive = false;
+    bool areOutputStagesSilent() const;
  
-//    Fills up the presets vector.
-    void createPrograms();
-//    Contains all preset objects
-    std::vector<Preset> presets;
 //    Index of the currently selected preset
     int currentProgram;
     
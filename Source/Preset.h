@@ -17,25 +17,30 @@
 
 #pragma once
 
-#include <cstring>
+#include <cstddef>
 
 const int NUM_PARAMS = 26;
 
+//The constructor is constexpr, so the table of factory presets
+//can be built at compile time (see FactoryPresets.h).
 struct Preset {
-    Preset(const char* name,
+//    Empty preset, used as a buffer for presets read from a file.
+    constexpr Preset() = default;
+    
+    constexpr Preset(const char* name,
         float p0, float p1, float p2, float p3, float p4, float p5,
         float p6, float p7, float p8, float p9, float p10, float p11,
         float p12, float p13, float p14, float p15, float p16, float p17,
         float p18, float p19, float p20, float p21, float p22, float p23,
         float p24, float p25)
     {
-//        Copy the name string with a length check
-        strncpy(this->name, name, sizeof(this->name) - 1);
-        
-//        Ensure null-termination.
-//        This line ensures that the destination buffer
-//        (this->name) is null-terminated.
-        this->name[sizeof(this->name) - 1] = '\0';
+//        Copy the name string with a length check.
+//        strncpy can't be used in a constexpr function.
+//        The rest of the name is already zero, which
+//        ensures null-termination.
+        for (size_t i = 0; i < sizeof(this->name) - 1 && name[i] != '\0'; ++i) {
+            this->name[i] = name[i];
+        }
         
 //        Assign parameters to the param array
         param[0] = p0;   // Osc Mix
@@ -67,6 +72,6 @@ struct Preset {
     }
     
 //Member variables
-char name[40];
-float param[NUM_PARAMS];
+char name[40] {};
+float param[NUM_PARAMS] {};
 };
@@ -0,0 +1,464 @@
+/*
+  ==============================================================================
+
+    PresetLibrary.cpp
+    Created: 18 Oct 2026 11:05:31am
+    Author:  MacJay
+
+  ==============================================================================
+*/
+
+#include "PresetLibrary.h"
+
+static constexpr int headerSize = int(sizeof(int32_t) * 4);
+static constexpr int32_t bankMagic = 0x4B42584A;    // "JXBK"
+static constexpr int32_t indexMagic = 0x5849584A;   // "JXIX"
+static constexpr int32_t fileVersion = 1;
+
+//Number of unsorted index entries before a compaction is started.
+static constexpr int maxUnsortedEntries = 64;
+
+//==============================================================================
+PresetLibrary::PresetLibrary() : juce::Thread("JX11 preset compaction") {}
+
+PresetLibrary::~PresetLibrary()
+{
+    stopThread(5000);
+}
+
+juce::File PresetLibrary::getDefaultFile()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+            .getChildFile("JX11")
+            .getChildFile("UserPresets.jx11bank");
+}
+
+bool PresetLibrary::open(const juce::File& file)
+{
+    const juce::ScopedLock sl(lock);
+
+    isOpen = false;
+    bankFile = file;
+    indexFile = file.withFileExtension("jx11idx");
+    mapFiles();
+
+//    No bank yet. It gets created by append().
+    if (bankMap == nullptr) {
+        isOpen = !bankFile.exists();
+        return isOpen;
+    }
+
+    FileHeader header = readHeader(bankMap.get());
+    if (header.magic != bankMagic || header.count1 != int32_t(sizeof(Preset))) {
+        bankMap.reset();
+        indexMap.reset();
+        return false;
+    }
+    isOpen = true;
+
+//    If the index is missing or doesn't know about all the records
+//    (for example because writing it was interrupted), the names of
+//    the missing records are added to its unsorted tail.
+    int numRecords = countRecords(bankMap.get());
+    int indexedRecords = 0;
+    if (indexMap != nullptr && readHeader(indexMap.get()).magic == indexMagic) {
+        indexedRecords = readHeader(indexMap.get()).count2;
+    } else {
+        indexFile.deleteFile();
+        FileHeader indexHeader { indexMagic, fileVersion, 0, 0 };
+        if (!writeFile(indexFile, indexHeader, nullptr, 0)) {
+            return false;
+        }
+        mapFiles();
+    }
+
+    if (indexedRecords < numRecords) {
+        std::vector<IndexEntry> entries;
+        for (int record = indexedRecords; record < numRecords; ++record) {
+            Preset preset = readRecord(bankMap.get(), record);
+            entries.push_back(makeEntry(preset.name, record, false));
+        }
+        appendEntries(entries, numRecords);
+        mapFiles();
+    }
+
+    if (countEntries(indexMap.get()) - readHeader(indexMap.get()).count1 > maxUnsortedEntries) {
+        compact();
+    }
+    return true;
+}
+
+int PresetLibrary::getNumPresets() const
+{
+    const juce::ScopedLock sl(lock);
+    return countRecords(bankMap.get());
+}
+
+bool PresetLibrary::getPreset(int record, Preset& preset) const
+{
+    const juce::ScopedLock sl(lock);
+    if (record < 0 || record >= countRecords(bankMap.get())) {
+        return false;
+    }
+    preset = readRecord(bankMap.get(), record);
+    return true;
+}
+
+juce::String PresetLibrary::getPresetName(int record) const
+{
+    Preset preset;
+    if (!getPreset(record, preset)) {
+        return {};
+    }
+    return juce::String(juce::CharPointer_UTF8(preset.name));
+}
+
+juce::Array<int> PresetLibrary::search(const juce::String& text, int firstResult, int maxResults) const
+{
+    juce::Array<int> results;
+    IndexEntry query = makeEntry(text, 0, false);
+    size_t prefixLength = strlen(query.key);
+//    Without search text only the names are listed, not the tags.
+    bool namesOnly = (prefixLength == 0);
+
+    const juce::ScopedLock sl(lock);
+    const juce::MemoryMappedFile* map = indexMap.get();
+    int numRecords = countRecords(bankMap.get());
+    int numEntries = countEntries(map);
+    if (numEntries == 0) {
+        return results;
+    }
+    int numSorted = juce::jlimit(0, numEntries, int(readHeader(map).count1));
+
+//    A preset can match by its name and by one or more tags,
+//    but should only be listed once.
+    std::vector<bool> listed(size_t(numRecords), false);
+    int matches = 0;
+
+    auto addMatch = [&](const IndexEntry& entry) {
+        if ((namesOnly && entry.isTag) || entry.record >= uint32_t(numRecords)
+                || listed[entry.record]) {
+            return;
+        }
+        listed[entry.record] = true;
+        if (matches++ >= firstResult) {
+            results.add(int(entry.record));
+        }
+    };
+
+//    Binary search for the first sorted entry with the prefix.
+    int low = 0;
+    int high = numSorted;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        IndexEntry entry = readEntry(map, mid);
+        if (strncmp(entry.key, query.key, prefixLength) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+//    All entries with the prefix follow each other.
+    for (int i = low; i < numSorted && results.size() < maxResults; ++i) {
+        IndexEntry entry = readEntry(map, i);
+        if (strncmp(entry.key, query.key, prefixLength) != 0) {
+            break;
+        }
+        addMatch(entry);
+    }
+
+//    The tail has not been sorted yet.
+    for (int i = numSorted; i < numEntries && results.size() < maxResults; ++i) {
+        IndexEntry entry = readEntry(map, i);
+        if (strncmp(entry.key, query.key, prefixLength) == 0) {
+            addMatch(entry);
+        }
+    }
+    return results;
+}
+
+bool PresetLibrary::append(const Preset& preset, const juce::StringArray& tags)
+{
+    const juce::ScopedLock sl(lock);
+    if (!isOpen) {
+        return false;
+    }
+
+//    First preset ever: create both files.
+    if (!bankFile.existsAsFile()) {
+        indexFile.deleteFile();
+        FileHeader bankHeader { bankMagic, fileVersion, int32_t(sizeof(Preset)), 0 };
+        FileHeader indexHeader { indexMagic, fileVersion, 0, 0 };
+        if (!writeFile(bankFile, bankHeader, nullptr, 0)
+                || !writeFile(indexFile, indexHeader, nullptr, 0)) {
+            return false;
+        }
+        mapFiles();
+    }
+
+    int record = countRecords(bankMap.get());
+    bankMap.reset();
+
+//    Records are only ever added to the end of the file.
+//    FileOutputStream starts writing at the end of an existing file.
+    {
+        juce::FileOutputStream stream(bankFile);
+        if (!stream.openedOk() || !stream.write(&preset, sizeof(Preset))) {
+            return false;
+        }
+    }
+
+    std::vector<IndexEntry> entries;
+    entries.push_back(makeEntry(juce::CharPointer_UTF8(preset.name), record, false));
+    for (const auto& tag : tags) {
+        entries.push_back(makeEntry(tag, record, true));
+    }
+    bool ok = appendEntries(entries, record + 1);
+    mapFiles();
+
+    if (countEntries(indexMap.get()) - readHeader(indexMap.get()).count1 > maxUnsortedEntries) {
+        compact();
+    }
+    return ok;
+}
+
+void PresetLibrary::compact()
+{
+    if (!isThreadRunning()) {
+        startThread();
+    }
+}
+
+//==============================================================================
+PresetLibrary::IndexEntry PresetLibrary::makeEntry(const juce::String& text, int record, bool isTag)
+{
+    IndexEntry entry {};
+    text.toLowerCase().copyToUTF8(entry.key, sizeof(entry.key));
+    entry.record = uint32_t(record);
+    entry.isTag = isTag ? 1 : 0;
+    return entry;
+}
+
+PresetLibrary::FileHeader PresetLibrary::readHeader(const juce::MemoryMappedFile* map)
+{
+    FileHeader header {};
+    if (map != nullptr && map->getData() != nullptr && map->getSize() >= size_t(headerSize)) {
+        memcpy(&header, map->getData(), sizeof(header));
+    }
+    return header;
+}
+
+int PresetLibrary::countRecords(const juce::MemoryMappedFile* map)
+{
+    if (map == nullptr || map->getData() == nullptr || map->getSize() < size_t(headerSize)) {
+        return 0;
+    }
+    return int((map->getSize() - size_t(headerSize)) / sizeof(Preset));
+}
+
+int PresetLibrary::countEntries(const juce::MemoryMappedFile* map)
+{
+    if (map == nullptr || map->getData() == nullptr || map->getSize() < size_t(headerSize)) {
+        return 0;
+    }
+    return int((map->getSize() - size_t(headerSize)) / sizeof(IndexEntry));
+}
+
+//The mapped data has no particular alignment, so records
+//and entries are copied out with memcpy.
+Preset PresetLibrary::readRecord(const juce::MemoryMappedFile* map, int record)
+{
+    Preset preset;
+    const char* data = static_cast<const char*>(map->getData());
+    memcpy(&preset, data + headerSize + size_t(record) * sizeof(Preset), sizeof(Preset));
+//    Never trust the file to be null-terminated.
+    preset.name[sizeof(preset.name) - 1] = '\0';
+    return preset;
+}
+
+PresetLibrary::IndexEntry PresetLibrary::readEntry(const juce::MemoryMappedFile* map, int entry)
+{
+    IndexEntry result;
+    const char* data = static_cast<const char*>(map->getData());
+    memcpy(&result, data + headerSize + size_t(entry) * sizeof(IndexEntry), sizeof(IndexEntry));
+    result.key[sizeof(result.key) - 1] = '\0';
+    return result;
+}
+
+bool PresetLibrary::writeFile(const juce::File& file, const FileHeader& header,
+                              const void* data, size_t size)
+{
+    file.getParentDirectory().createDirectory();
+    juce::FileOutputStream stream(file);
+    if (!stream.openedOk()) {
+        return false;
+    }
+    stream.setPosition(0);
+    stream.truncate();
+    bool ok = stream.write(&header, sizeof(header));
+    if (size > 0) {
+        ok = ok && stream.write(data, size);
+    }
+    stream.flush();
+    return ok && stream.getStatus().wasOk();
+}
+
+void PresetLibrary::mapFiles()
+{
+//    The old mappings must be closed first, otherwise
+//    some systems don't allow the files to be replaced.
+    bankMap.reset();
+    indexMap.reset();
+
+    if (bankFile.existsAsFile()) {
+        bankMap = std::make_unique<juce::MemoryMappedFile>(bankFile, juce::MemoryMappedFile::readOnly);
+        if (bankMap->getData() == nullptr) {
+            bankMap.reset();
+        }
+    }
+    if (indexFile.existsAsFile()) {
+        indexMap = std::make_unique<juce::MemoryMappedFile>(indexFile, juce::MemoryMappedFile::readOnly);
+        if (indexMap->getData() == nullptr) {
+            indexMap.reset();
+        }
+    }
+}
+
+bool PresetLibrary::appendEntries(const std::vector<IndexEntry>& entries, int numRecords)
+{
+    FileHeader header = readHeader(indexMap.get());
+    if (header.magic != indexMagic) {
+        header = { indexMagic, fileVersion, 0, 0 };
+    }
+    header.count2 = numRecords;
+
+//    Close the mapping before the file is written to.
+    indexMap.reset();
+
+    juce::FileOutputStream stream(indexFile);
+    if (!stream.openedOk()) {
+        return false;
+    }
+    bool ok = true;
+    if (!entries.empty()) {
+        ok = stream.write(entries.data(), entries.size() * sizeof(IndexEntry));
+    }
+//    The header is updated last. If writing the entries got
+//    interrupted, open() adds the missing names again.
+    ok = ok && stream.setPosition(0) && stream.write(&header, sizeof(header));
+    stream.flush();
+    return ok;
+}
+
+//==============================================================================
+void PresetLibrary::run()
+{
+    std::unique_ptr<juce::MemoryMappedFile> bankData;
+    std::unique_ptr<juce::MemoryMappedFile> indexData;
+    juce::File bank;
+    juce::File index;
+
+//    The compaction works on its own mappings of the files as they
+//    are now. Presets that get appended in the meantime only add to
+//    the end of the files and are taken care of at the end.
+    {
+        const juce::ScopedLock sl(lock);
+        bank = bankFile;
+        index = indexFile;
+        if (!bank.existsAsFile() || !index.existsAsFile()) {
+            return;
+        }
+        bankData = std::make_unique<juce::MemoryMappedFile>(bank, juce::MemoryMappedFile::readOnly);
+        indexData = std::make_unique<juce::MemoryMappedFile>(index, juce::MemoryMappedFile::readOnly);
+    }
+
+    int numRecords = juce::jmin(countRecords(bankData.get()),
+                                int(readHeader(indexData.get()).count2));
+    int numEntries = countEntries(indexData.get());
+
+//    The newest record with a given name wins.
+    std::map<juce::String, int> newest;
+    for (int record = 0; record < numRecords; ++record) {
+        newest[juce::String(juce::CharPointer_UTF8(readRecord(bankData.get(), record).name)).toLowerCase()] = record;
+    }
+
+//    Old record number -> new record number, or -1 if it's dropped.
+    std::vector<int> renumber(size_t(numRecords), -1);
+    juce::MemoryBlock records;
+    int numKept = 0;
+    for (int record = 0; record < numRecords; ++record) {
+        Preset preset = readRecord(bankData.get(), record);
+        if (newest[juce::String(juce::CharPointer_UTF8(preset.name)).toLowerCase()] == record) {
+            renumber[size_t(record)] = numKept++;
+            records.append(&preset, sizeof(Preset));
+        }
+    }
+
+    std::vector<IndexEntry> entries;
+    for (int i = 0; i < numEntries; ++i) {
+        IndexEntry entry = readEntry(indexData.get(), i);
+        if (entry.record < uint32_t(numRecords) && renumber[entry.record] >= 0) {
+            entry.record = uint32_t(renumber[entry.record]);
+            entries.push_back(entry);
+        }
+    }
+    std::sort(entries.begin(), entries.end(), [](const IndexEntry& a, const IndexEntry& b) {
+        int order = strcmp(a.key, b.key);
+        return order < 0 || (order == 0 && a.record < b.record);
+    });
+
+    bankData.reset();
+    indexData.reset();
+    if (threadShouldExit()) {
+        return;
+    }
+
+    juce::File tempBank = bank.getSiblingFile(bank.getFileName() + ".tmp");
+    juce::File tempIndex = index.getSiblingFile(index.getFileName() + ".tmp");
+    FileHeader bankHeader { bankMagic, fileVersion, int32_t(sizeof(Preset)), 0 };
+    FileHeader indexHeader { indexMagic, fileVersion, int32_t(entries.size()), numKept };
+    if (!writeFile(tempBank, bankHeader, records.getData(), records.getSize())
+            || !writeFile(tempIndex, indexHeader, entries.data(), entries.size() * sizeof(IndexEntry))) {
+        tempBank.deleteFile();
+        tempIndex.deleteFile();
+        return;
+    }
+
+    {
+        const juce::ScopedLock sl(lock);
+
+//        Copy the presets that were appended during the compaction.
+//        They stay in the unsorted tail of the new index.
+        int total = countRecords(bankMap.get());
+        if (total > numRecords) {
+            juce::FileOutputStream bankStream(tempBank);
+            for (int record = numRecords; record < total; ++record) {
+                Preset preset = readRecord(bankMap.get(), record);
+                bankStream.write(&preset, sizeof(Preset));
+            }
+
+            juce::FileOutputStream indexStream(tempIndex);
+            int entriesNow = countEntries(indexMap.get());
+            for (int i = 0; i < entriesNow; ++i) {
+                IndexEntry entry = readEntry(indexMap.get(), i);
+                if (entry.record >= uint32_t(numRecords) && entry.record < uint32_t(total)) {
+                    entry.record = uint32_t(numKept + int(entry.record) - numRecords);
+                    indexStream.write(&entry, sizeof(IndexEntry));
+                }
+            }
+            indexHeader.count2 = numKept + total - numRecords;
+            indexStream.setPosition(0);
+            indexStream.write(&indexHeader, sizeof(indexHeader));
+        }
+
+        bankMap.reset();
+        indexMap.reset();
+        tempBank.moveFileTo(bankFile);
+        tempIndex.moveFileTo(indexFile);
+        mapFiles();
+    }
+
+//    Record numbers have changed.
+    sendChangeMessage();
+}
@@ -0,0 +1,125 @@
+/*
+  ==============================================================================
+
+    PresetLibrary.h
+    Created: 18 Oct 2026 11:05:31am
+    Author:  MacJay
+
+    File-based bank for user presets.
+
+    The bank file holds fixed-size records with the same layout as Preset
+    (name and param[NUM_PARAMS]). Because every record has the same size,
+    record n can be found without reading the ones before it. The file is
+    memory-mapped read-only, so opening even a large bank costs almost
+    nothing and only the pages that are actually looked at get loaded.
+
+    The index file next to it holds one entry per preset name and per
+    tag. The first part of the index is sorted, which makes searching
+    for a prefix a binary search. New presets are only ever appended to
+    both files. Their index entries go to an unsorted tail, which is
+    scanned linearly. Once that tail gets too long, a background thread
+    compacts the bank: it removes older presets with the same name and
+    writes a fully sorted index.
+
+    Both files are stored in the byte order of the machine. They are a
+    local library and not meant to be exchanged between computers.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "Preset.h"
+
+class PresetLibrary : public juce::ChangeBroadcaster,
+                      private juce::Thread
+{
+public:
+    PresetLibrary();
+    ~PresetLibrary() override;
+
+//    Opens the bank with the given file name. The index file has the
+//    same name with the extension .jx11idx. A bank that doesn't exist
+//    yet is created by the first call to append(). If the file isn't
+//    a bank, it returns false and the bank stays closed.
+    bool open(const juce::File& file);
+
+//    Number of records in the bank.
+    int getNumPresets() const;
+
+//    Copies record number `record` into `preset`.
+    bool getPreset(int record, Preset& preset) const;
+    juce::String getPresetName(int record) const;
+
+//    Returns the records whose name or one of its tags starts with
+//    `text` (not case-sensitive). An empty text pages through all
+//    presets in alphabetical order. Skips the first `firstResult`
+//    matches and returns at most `maxResults` of them.
+    juce::Array<int> search(const juce::String& text, int firstResult, int maxResults) const;
+
+//    Adds a preset to the end of the bank. A preset with the same
+//    name as an older one replaces it after the next compaction.
+//    Does nothing if the bank isn't open.
+    bool append(const Preset& preset, const juce::StringArray& tags = {});
+
+//    Starts compacting the bank on the background thread.
+//    Record numbers change when it's done, which is reported
+//    to the ChangeListeners on the message thread.
+    void compact();
+
+//    The bank in the user's application data folder.
+    static juce::File getDefaultFile();
+
+private:
+//    Both files start with this header.
+//    Bank:  magic, version, record size, unused.
+//    Index: magic, version, number of sorted entries,
+//           number of records covered by the index.
+    struct FileHeader {
+        int32_t magic;
+        int32_t version;
+        int32_t count1;
+        int32_t count2;
+    };
+
+//    One searchable key (name or tag, in lowercase)
+//    and the record it belongs to.
+    struct IndexEntry {
+        char key[40];
+        uint32_t record;
+        uint32_t isTag;
+    };
+
+    static IndexEntry makeEntry(const juce::String& text, int record, bool isTag);
+    static FileHeader readHeader(const juce::MemoryMappedFile* map);
+    static int countRecords(const juce::MemoryMappedFile* map);
+    static int countEntries(const juce::MemoryMappedFile* map);
+    static Preset readRecord(const juce::MemoryMappedFile* map, int record);
+    static IndexEntry readEntry(const juce::MemoryMappedFile* map, int entry);
+    static bool writeFile(const juce::File& file, const FileHeader& header,
+                          const void* data, size_t size);
+
+//    Maps both files again after they have changed.
+    void mapFiles();
+//    Appends entries to the unsorted tail of the index.
+    bool appendEntries(const std::vector<IndexEntry>& entries, int numRecords);
+
+//    Compaction on the background thread.
+    void run() override;
+
+    juce::File bankFile;
+    juce::File indexFile;
+    std::unique_ptr<juce::MemoryMappedFile> bankMap;
+    std::unique_ptr<juce::MemoryMappedFile> indexMap;
+    
+//    False until open() succeeds, so a file that
+//    isn't a bank never gets written to.
+    bool isOpen = false;
+
+//    Only used by the message thread and the compaction
+//    thread, never by the audio thread.
+    juce::CriticalSection lock;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PresetLibrary)
+};
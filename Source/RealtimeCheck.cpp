@@ -0,0 +1,276 @@
+/*
+  ==============================================================================
+
+    RealtimeCheck.cpp
+    Created: 18 Oct 2026 7:31:47pm
+    Author:  MacJay
+
+  ==============================================================================
+*/
+
+#include "RealtimeCheck.h"
+
+#if JX11_REALTIME_CHECKS
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if defined(__GLIBC__)
+ #include <dlfcn.h>
+ #include <pthread.h>
+#endif
+
+//On Linux the variables use the initial-exec model, so reading them
+//never calls into the dynamic linker, which could allocate and come
+//back into malloc() below.
+#if defined(__GNUC__) && defined(__linux__)
+ #define JX11_THREAD_LOCAL thread_local __attribute__((tls_model("initial-exec")))
+#else
+ #define JX11_THREAD_LOCAL thread_local
+#endif
+
+namespace {
+    JX11_THREAD_LOCAL int realtimeDepth = 0;
+    
+//    Set while fail() reports, in case printing allocates.
+    JX11_THREAD_LOCAL bool failing = false;
+}
+
+namespace RealtimeCheck {
+    Scope::Scope()
+    {
+        ++realtimeDepth;
+    }
+
+    Scope::~Scope()
+    {
+        --realtimeDepth;
+    }
+
+    bool isRealtime()
+    {
+        return realtimeDepth > 0 && !failing;
+    }
+
+    void fail(const char* what)
+    {
+        failing = true;
+        std::fprintf(stderr, "JX11 realtime check: %s on the audio thread\n", what);
+        std::fflush(stderr);
+        std::abort();
+    }
+}
+
+//    Replacements for the global allocation functions. They only
+//    check the thread and then do what the standard ones do.
+void* operator new(std::size_t size)
+{
+    if (RealtimeCheck::isRealtime()) {
+        RealtimeCheck::fail("operator new");
+    }
+    if (void* ptr = std::malloc(size > 0 ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    if (RealtimeCheck::isRealtime()) {
+        RealtimeCheck::fail("operator new");
+    }
+    return std::malloc(size > 0 ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    if (ptr != nullptr && RealtimeCheck::isRealtime()) {
+        RealtimeCheck::fail("operator delete");
+    }
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+    operator delete(ptr);
+}
+
+//    The aligned versions, used for types declared with alignas()
+//    above the default alignment, such as some SIMD types.
+static void* allocateAligned(std::size_t size, std::align_val_t alignment) noexcept
+{
+    if (RealtimeCheck::isRealtime()) {
+        RealtimeCheck::fail("operator new");
+    }
+    auto align = static_cast<std::size_t>(alignment);
+#if defined(_WIN32)
+    return _aligned_malloc(size > 0 ? size : 1, align);
+#else
+//    aligned_alloc() wants the size to be a multiple of the alignment.
+    size = (size + align - 1) & ~(align - 1);
+    return std::aligned_alloc(align, size > 0 ? size : align);
+#endif
+}
+
+static void freeAligned(void* ptr) noexcept
+{
+    if (ptr != nullptr && RealtimeCheck::isRealtime()) {
+        RealtimeCheck::fail("operator delete");
+    }
+#if defined(_WIN32)
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    if (void* ptr = allocateAligned(size, alignment)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return allocateAligned(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return allocateAligned(size, alignment);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+    freeAligned(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept
+{
+    freeAligned(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept
+{
+    freeAligned(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept
+{
+    freeAligned(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    freeAligned(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    freeAligned(ptr);
+}
+
+//    The C allocation functions, which JUCE's HeapBlock and most C
+//    libraries use. With glibc they can be replaced by defining them
+//    and forwarding to glibc's own entry points. A definition in an
+//    executable replaces them for the whole process. In a plug-in
+//    loaded by a host, calls usually still find the host's first.
+#if defined(__GLIBC__)
+extern "C" {
+    void* __libc_malloc(std::size_t size);
+    void* __libc_calloc(std::size_t count, std::size_t size);
+    void* __libc_realloc(void* ptr, std::size_t size);
+    void __libc_free(void* ptr);
+
+    void* malloc(std::size_t size)
+    {
+        if (RealtimeCheck::isRealtime()) {
+            RealtimeCheck::fail("malloc()");
+        }
+        return __libc_malloc(size);
+    }
+
+    void* calloc(std::size_t count, std::size_t size)
+    {
+        if (RealtimeCheck::isRealtime()) {
+            RealtimeCheck::fail("calloc()");
+        }
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* ptr, std::size_t size)
+    {
+        if (RealtimeCheck::isRealtime()) {
+            RealtimeCheck::fail("realloc()");
+        }
+        return __libc_realloc(ptr, size);
+    }
+
+    void free(void* ptr)
+    {
+        if (ptr != nullptr && RealtimeCheck::isRealtime()) {
+            RealtimeCheck::fail("free()");
+        }
+        __libc_free(ptr);
+    }
+}
+
+//    pthread_mutex_lock() is behind juce::CriticalSection, std::mutex
+//    and most other locks. The real one is looked up the first time.
+//    dlsym() may allocate, which is fine outside the audio thread.
+extern "C" int pthread_mutex_lock(pthread_mutex_t* mutex) noexcept
+{
+    if (RealtimeCheck::isRealtime()) {
+        RealtimeCheck::fail("pthread_mutex_lock()");
+    }
+    using LockFunction = int (*)(pthread_mutex_t*);
+    static std::atomic<LockFunction> next {nullptr};
+    auto function = next.load(std::memory_order_relaxed);
+    if (function == nullptr) {
+        function = reinterpret_cast<LockFunction>(dlsym(RTLD_NEXT, "pthread_mutex_lock"));
+        next.store(function, std::memory_order_relaxed);
+    }
+    return function(mutex);
+}
+#endif
+
+#endif
@@ -0,0 +1,99 @@
+/*
+  ==============================================================================
+
+    RealtimeCheck.h
+    Created: 18 Oct 2026 7:31:47pm
+    Author:  MacJay
+
+    A build mode for testing that stops the plug-in as soon as the
+    audio thread allocates memory, frees it or calls something that
+    can block. Turn it on with the preprocessor definition
+    JX11_REALTIME_CHECKS=1 in the Projucer, off in release builds.
+
+    processBlock() marks its thread with a Scope. While the scope
+    exists, every form of the global operator new and delete
+    (RealtimeCheck.cpp) fails, and so does every function that starts
+    with JX11_ASSERT_NOT_REALTIME: loading presets, the state, the MIDI
+    learn table and the morph table.
+
+    The locks in JX11 are RealtimeCheck::CriticalSection and SpinLock,
+    which fail when the audio thread waits on them. Trying a lock
+    without waiting is allowed. With glibc, pthread_mutex_lock() is
+    replaced too, which catches the locks in JUCE and the standard
+    library, under the same conditions as malloc() below.
+
+    malloc(), calloc(), realloc() and free() are caught with glibc
+    only, and for certain only in an executable such as the test app
+    (Tests/JX11Tests.jucer). In a plug-in loaded by a host, and on
+    macOS and Windows, only C++ new and delete are covered, so a
+    juce::HeapBlock or a C library allocating there goes unnoticed.
+
+    Tests/RealtimeStressTest.cpp plays all factory presets with random
+    MIDI in every mode under these checks. The audio thread has no DBG
+    or other logging that allocates, it writes to a RealtimeLog
+    instead, so the test can pass.
+
+    Without JX11_REALTIME_CHECKS all of this compiles to nothing.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#ifndef JX11_REALTIME_CHECKS
+ #define JX11_REALTIME_CHECKS 0
+#endif
+
+namespace RealtimeCheck {
+#if JX11_REALTIME_CHECKS
+//    Marks the current thread as the audio thread while it exists.
+    struct Scope {
+        Scope();
+        ~Scope();
+    };
+
+    bool isRealtime();
+
+//    Prints what happened and aborts, so a test can't miss it.
+    [[noreturn]] void fail(const char* what);
+#else
+    struct Scope {
+        Scope() {}
+    };
+#endif
+}
+
+#if JX11_REALTIME_CHECKS
+ #define JX11_ASSERT_NOT_REALTIME(what) \
+    do { if (RealtimeCheck::isRealtime()) RealtimeCheck::fail(what); } while (false)
+#else
+ #define JX11_ASSERT_NOT_REALTIME(what) do {} while (false)
+#endif
+
+namespace RealtimeCheck {
+#if JX11_REALTIME_CHECKS
+//    A lock that fails when the audio thread has to wait for it.
+//    The scoped lock types are redefined so they call this enter().
+    template <typename LockType>
+    class CheckedLock : public LockType {
+    public:
+        void enter() const noexcept
+        {
+            JX11_ASSERT_NOT_REALTIME("Waiting for a lock");
+            LockType::enter();
+        }
+        
+        using ScopedLockType = juce::GenericScopedLock<CheckedLock>;
+        using ScopedUnlockType = juce::GenericScopedUnlock<CheckedLock>;
+        using ScopedTryLockType = juce::GenericScopedTryLock<CheckedLock>;
+    };
+#else
+    template <typename LockType>
+    using CheckedLock = LockType;
+#endif
+
+    using CriticalSection = CheckedLock<juce::CriticalSection>;
+    using SpinLock = CheckedLock<juce::SpinLock>;
+}
@@ -0,0 +1,150 @@
+/*
+  ==============================================================================
+
+    RealtimeLog.h
+    Created: 18 Oct 2026 7:58:09pm
+    Author:  MacJay
+
+    Logging from the audio thread. DBG builds a juce::String and
+    writes it out on the spot, which allocates and can block, so it
+    has no place in the render code and is gone in release builds
+    anyway.
+
+    The audio thread only writes small fixed-size records (what
+    happened, where in the block, a value) into a RealtimeLog. A
+    background thread, RealtimeLogThread, picks them up a few times
+    per second, formats them and hands them to juce::Logger. Writing
+    a record never waits, so the log stays on in release builds.
+
+    Each processor has its own log with one writer, its audio thread,
+    and one reader, the log thread, so a juce::AbstractFifo is enough.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "RealtimeCheck.h"
+
+class RealtimeLog
+{
+public:
+    enum Code : uint16_t {
+        nanSilenced,
+        infSilenced,
+        outOfRangeClamped,
+        midiCCLearned,
+    };
+
+    struct Record {
+        Code code;
+        int sampleIndex;
+        float value;
+    };
+
+    static constexpr int capacity = 512;
+
+//    Audio thread. Never allocates or waits. If the log thread
+//    falls behind, the record is dropped and counted.
+    void write(Code code, int sampleIndex, float value)
+    {
+        const auto scope = fifo.write(1);
+        if (scope.blockSize1 > 0) {
+            records[size_t(scope.startIndex1)] = { code, sampleIndex, value };
+        } else if (scope.blockSize2 > 0) {
+            records[size_t(scope.startIndex2)] = { code, sampleIndex, value };
+        } else {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+//    Log thread. Formats the waiting records and sends them
+//    to juce::Logger.
+    void flush()
+    {
+        const auto scope = fifo.read(fifo.getNumReady());
+        for (int i = 0; i < scope.blockSize1; ++i) {
+            juce::Logger::writeToLog(format(records[size_t(scope.startIndex1 + i)]));
+        }
+        for (int i = 0; i < scope.blockSize2; ++i) {
+            juce::Logger::writeToLog(format(records[size_t(scope.startIndex2 + i)]));
+        }
+
+        int numDropped = dropped.exchange(0, std::memory_order_relaxed);
+        if (numDropped > 0) {
+            juce::Logger::writeToLog("JX11: " + juce::String(numDropped) + " log messages dropped");
+        }
+    }
+
+private:
+    static juce::String format(const Record& record)
+    {
+        juce::String where = " at sample " + juce::String(record.sampleIndex);
+        switch (record.code) {
+            case nanSilenced:
+                return "JX11: !!! nan detected in audio buffer" + where + ", silencing !!!";
+            case infSilenced:
+                return "JX11: !!! inf detected in audio buffer" + where + ", silencing !!!";
+            case outOfRangeClamped:
+                return "JX11: sample out of range (" + juce::String(record.value) + ")" + where + ", clamping";
+            case midiCCLearned:
+                return "JX11: learned MIDI CC " + juce::String(int(record.value));
+        }
+        return "JX11: unknown log record";
+    }
+
+    juce::AbstractFifo fifo {capacity};
+    std::array<Record, capacity> records;
+    std::atomic<int> dropped {0};
+};
+
+//==============================================================================
+/*
+    One thread per process that empties the logs of all instances.
+*/
+class RealtimeLogThread : private juce::Thread
+{
+public:
+    RealtimeLogThread() : juce::Thread("JX11 log")
+    {
+        startThread();
+    }
+
+    ~RealtimeLogThread() override
+    {
+        stopThread(1000);
+    }
+
+//    Called by a processor when it's created and deleted. After
+//    remove() returns, the log isn't touched anymore.
+    void add(RealtimeLog& log)
+    {
+        const RealtimeCheck::CriticalSection::ScopedLockType lock(logsLock);
+        logs.addIfNotAlreadyThere(&log);
+    }
+
+    void remove(RealtimeLog& log)
+    {
+        const RealtimeCheck::CriticalSection::ScopedLockType lock(logsLock);
+        log.flush();
+        logs.removeFirstMatchingValue(&log);
+    }
+
+private:
+    void run() override
+    {
+        while (!threadShouldExit()) {
+            {
+                const RealtimeCheck::CriticalSection::ScopedLockType lock(logsLock);
+                for (auto* log : logs) {
+                    log->flush();
+                }
+            }
+            wait(200);
+        }
+    }
+
+    juce::Array<RealtimeLog*> logs;
+    RealtimeCheck::CriticalSection logsLock;
+};
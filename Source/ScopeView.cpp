@@ -0,0 +1,120 @@
+/*
+  ==============================================================================
+
+    ScopeView.cpp
+    Created: 18 Oct 2026 4:02:16pm
+    Author:  MacJay
+
+  ==============================================================================
+*/
+
+#include "ScopeView.h"
+
+static constexpr float minDecibels = -90.0f;
+//The spectrum falls by this many dB per frame.
+static constexpr float decayPerFrame = 3.0f;
+//Number of samples shown by the oscilloscope.
+static constexpr int scopeLength = 512;
+
+ScopeView::ScopeView(AudioScope& scope_) : scope(scope_)
+{
+    spectrum.fill(minDecibels);
+    setOpaque(true);
+    scope.setEnabled(true);
+    startTimerHz(30);
+}
+
+ScopeView::~ScopeView()
+{
+    stopTimer();
+    scope.setEnabled(false);
+}
+
+void ScopeView::timerCallback()
+{
+    bool newSamples = false;
+    for (;;) {
+        int count = scope.pull(pullBuffer.data(), int(pullBuffer.size()));
+        if (count == 0) {
+            break;
+        }
+        for (int i = 0; i < count; ++i) {
+            history[size_t(historyPos)] = pullBuffer[size_t(i)];
+            historyPos = (historyPos + 1) % fftSize;
+        }
+        newSamples = true;
+    }
+    if (!newSamples) {
+        return;
+    }
+
+//    Oldest sample first.
+    for (int i = 0; i < fftSize; ++i) {
+        fftData[size_t(i)] = history[size_t((historyPos + i) % fftSize)];
+    }
+    std::fill(fftData.begin() + fftSize, fftData.end(), 0.0f);
+
+    window.multiplyWithWindowingTable(fftData.data(), size_t(fftSize));
+    fft.performFrequencyOnlyForwardTransform(fftData.data());
+
+    for (size_t i = 0; i < spectrum.size(); ++i) {
+//        A full-scale sine ends up at about 0 dB. The Hann
+//        window halves the amplitude, hence the factor 4.
+        float level = juce::Decibels::gainToDecibels(fftData[i] * 4.0f / float(fftSize), minDecibels);
+        spectrum[i] = juce::jmax(level, spectrum[i] - decayPerFrame);
+    }
+
+    repaint();
+}
+
+void ScopeView::paint(juce::Graphics& g)
+{
+    g.fillAll(juce::Colour(15, 30, 45));
+
+    auto bounds = getLocalBounds().toFloat().reduced(4.0f);
+    auto scopeArea = bounds.removeFromLeft(bounds.getWidth() / 2.0f).reduced(2.0f);
+    auto spectrumArea = bounds.reduced(2.0f);
+
+    g.setColour(juce::Colour(65, 70, 80));
+    g.drawRect(scopeArea);
+    g.drawRect(spectrumArea);
+
+//    Oscilloscope: the last scopeLength samples.
+    juce::Path wave;
+    for (int i = 0; i < scopeLength; ++i) {
+        float sample = history[size_t((historyPos - scopeLength + i + fftSize) % fftSize)];
+        float x = scopeArea.getX() + scopeArea.getWidth() * float(i) / float(scopeLength - 1);
+        float y = scopeArea.getCentreY() - juce::jlimit(-1.0f, 1.0f, sample) * scopeArea.getHeight() * 0.5f;
+        if (i == 0) {
+            wave.startNewSubPath(x, y);
+        } else {
+            wave.lineTo(x, y);
+        }
+    }
+    g.setColour(juce::Colours::orange);
+    g.strokePath(wave, juce::PathStrokeType(1.5f));
+
+//    Spectrum on a logarithmic frequency axis from 20 Hz.
+    float nyquist = float(scope.getScopeSampleRate() * 0.5);
+    float minLogFreq = std::log(20.0f);
+    float logRange = std::log(nyquist) - minLogFreq;
+    float binWidth = nyquist / float(spectrum.size());
+
+    juce::Path curve;
+    bool started = false;
+    for (size_t i = 1; i < spectrum.size(); ++i) {
+        float freq = float(i) * binWidth;
+        if (freq < 20.0f) {
+            continue;
+        }
+        float x = spectrumArea.getX() + spectrumArea.getWidth() * (std::log(freq) - minLogFreq) / logRange;
+        float y = juce::jmap(juce::jmin(spectrum[i], 0.0f), minDecibels, 0.0f, spectrumArea.getBottom(), spectrumArea.getY());
+        if (!started) {
+            curve.startNewSubPath(x, y);
+            started = true;
+        } else {
+            curve.lineTo(x, y);
+        }
+    }
+    g.strokePath(curve, juce::PathStrokeType(1.5f));
+}
@@ -0,0 +1,54 @@
+/*
+  ==============================================================================
+
+    ScopeView.h
+    Created: 18 Oct 2026 4:02:16pm
+    Author:  MacJay
+
+    Oscilloscope (left half) and spectrum analyzer (right half) of the
+    synth's output. Reads the samples from AudioScope on a timer. The FFT
+    runs in the timer callback on the message thread, never on the
+    audio thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "AudioScope.h"
+
+class ScopeView : public juce::Component,
+                  private juce::Timer
+{
+public:
+    explicit ScopeView(AudioScope& scope);
+    ~ScopeView() override;
+
+    void paint(juce::Graphics& g) override;
+
+private:
+    void timerCallback() override;
+
+//    2048 points, at the decimated sample rate.
+    static constexpr int fftOrder = 11;
+    static constexpr int fftSize = 1 << fftOrder;
+
+    AudioScope& scope;
+
+    juce::dsp::FFT fft {fftOrder};
+    juce::dsp::WindowingFunction<float> window {size_t(fftSize), juce::dsp::WindowingFunction<float>::hann};
+
+//    The most recent scope samples, as a ring buffer.
+    std::array<float, fftSize> history {};
+    int historyPos = 0;
+
+//    Work space for the FFT, which needs twice the size.
+    std::array<float, 2 * fftSize> fftData {};
+//    Level of each frequency bin in dB, with a slow decay.
+    std::array<float, fftSize / 2> spectrum {};
+
+    std::array<float, 1024> pullBuffer {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ScopeView)
+};
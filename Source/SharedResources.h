@@ -0,0 +1,82 @@
+/*
+  ==============================================================================
+
+    SharedResources.h
+    Created: 18 Oct 2026 6:20:03pm
+    Author:  MacJay
+
+    Things that are the same for every instance of the plug-in and only
+    need to exist once per process. Hold it with
+    juce::SharedResourcePointer<SharedResources>: the first pointer
+    creates it, the last one deletes it. 50 instances in a session
+    then share one typeface, one user preset bank and one set of
+    knob images.
+
+    The factory presets don't need to be here. They are a constexpr
+    table in read-only memory (see FactoryPresets.h), which every
+    instance already shares.
+
+    Everything in here is used on the message thread only, apart from
+    the log thread, which empties the logs of all instances. The
+    typeface and the user bank are only made when they're first asked
+    for, and the knob images are drawn as the knobs need them.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PresetLibrary.h"
+#include "RealtimeLog.h"
+#include "RealtimeCheck.h"
+
+struct SharedResources
+{
+//    Created when the first editor opens, so instances that are
+//    never looked at don't pay for it. Building a typeface from
+//    the font data takes a moment, so it's only done once.
+    juce::Typeface::Ptr getTypeface()
+    {
+        const RealtimeCheck::CriticalSection::ScopedLockType lock(initLock);
+        if (typeface == nullptr) {
+//            Using font from BinaryData.
+            typeface = juce::Typeface::createSystemTypefaceFor(
+                    BinaryData::LatoMedium_ttf, BinaryData::LatoMedium_ttfSize);
+        }
+        return typeface;
+    }
+
+//    Every instance sees the presets saved by the others. The bank
+//    is opened the first time it's needed, which also starts the
+//    compaction thread if the index has grown too long.
+    PresetLibrary& getUserPresets()
+    {
+        const RealtimeCheck::CriticalSection::ScopedLockType lock(initLock);
+        if (!userPresetsOpened) {
+            userPresets.open(PresetLibrary::getDefaultFile());
+            userPresetsOpened = true;
+        }
+        return userPresets;
+    }
+
+//    Prerendered background arcs of the knobs, see LookAndFeel.
+    struct KnobImage {
+        int width;
+        int height;
+        float scale;
+        float startAngle;
+        float endAngle;
+        juce::Colour colour;
+        juce::Image image;
+    };
+    std::vector<KnobImage> knobImages;
+    
+    RealtimeLogThread logThread;
+
+private:
+    RealtimeCheck::CriticalSection initLock;
+    juce::Typeface::Ptr typeface;
+    PresetLibrary userPresets;
+    bool userPresetsOpened = false;
+};
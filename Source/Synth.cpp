@@ -12,6 +12,9 @@
 
 static const float ANALOG = 0.002f;
 static const int SUSTAIN = -1;
+//    Per-note MPE values move this much closer to
+//    their target with every LFO step.
+static const float MPE_SMOOTHING = 0.2f;
 
 Synth::Synth() : sampleRate(44100.0f) {}
 //==============================================================================
@@ -64,7 +67,6 @@ void Synth::reset()
     lfo = 0.0f;
     lfoStep = 0;
     
-    resonanceCtl = 1.0f;
     
 //    Smoothing time
     outputLevelSmoother.reset(sampleRate, 0.05f);
@@ -79,6 +81,9 @@ void Synth::reset()
     filterCtl = 0.0f;
     
     filterZip = 0.0f;
+    
+    mpeChannels.fill(MPEChannel());
+    noteVoices.fill(-1);
 }
 //==============================================================================
 
@@ -96,56 +101,91 @@ void Synth::render(float** outputBuffers, int sampleCount)
         if (voice.env.isActive()) {
             updatePeriod(voice);
             voice.glideRate = glideRate;
-            voice.filterQ = filterQ * resonanceCtl;
-            voice.pitchBend = pitchBend;
+            voice.filterQ = filterQ;
+            voice.pitchBend = pitchBend * voice.noteBend;
             voice.filterEnvDepth = filterEnvDepth;
         }
     }
     
-//    Loop thru the samples. If there were MIDI messages
+//    Loop thru the samples in chunks. If there were MIDI messages
 //    this will be less than the total number of samples in the block.
-    for (int sample = 0; sample < sampleCount; ++sample) {
-//        Adding vibrato
+//    The LFO only moves every LFO_MAX samples, so in between the
+//    voices can be rendered one after the other, each into its own
+//    small block, and mixed into the output with vector operations.
+    float noiseBlock[LFO_MAX];
+    float voiceBlock[LFO_MAX];
+    float gainBlock[LFO_MAX];
+    float monoRight[LFO_MAX];
+    
+    int sample = 0;
+    while (sample < sampleCount) {
+//        Adding vibrato. Steps the LFO like it does for every sample,
+//        lfoStep then says how many samples share the same LFO value.
         updateLFO();
-//        Next output from noise generator multiplied by
-//        the parameter noise (noiseMix).
-        float noise = noiseGen.nextValue() * noiseMix;
+        int chunk = std::min(sampleCount - sample, lfoStep);
+//        Counts off the samples of this chunk after the first one.
+        lfoStep -= chunk - 1;
         
-//        Output for the left and right speaker
-        float outputLeft = 0.0f;
-        float outputRight = 0.0f;
+//        Next outputs from noise generator multiplied by
+//        the parameter noise (noiseMix). Every voice gets the same noise.
+        for (int i = 0; i < chunk; ++i) {
+            noiseBlock[i] = noiseGen.nextValue() * noiseMix;
+        }
         
-        for (int i = 0; i < MAX_VOICES; ++i) {
-            Voice& voice = voices[i];
-//        Check if key is pressed.
-            if (voice.env.isActive()) {
-//            Audio data with added noise.
-                float output = voice.render(noise);
-//            Sample is mixed into the left/right
+//        Output for the left and right speaker. In mono, the
+//        right channel is mixed in a scratch block first.
+        float* outputLeft = outputBufferLeft + sample;
+        float* outputRight = (outputBufferRight != nullptr) ? outputBufferRight + sample : monoRight;
+        juce::FloatVectorOperations::clear(outputLeft, chunk);
+        juce::FloatVectorOperations::clear(outputRight, chunk);
+        
+        for (int v = 0; v < MAX_VOICES; ++v) {
+            Voice& voice = voices[v];
+//            Check if key is pressed.
+            if (!voice.env.isActive()) {
+                continue;
+            }
+//            Audio data with added noise. A voice that dies out
+//            within the chunk is silent for the rest of it.
+            int i = 0;
+            for (; i < chunk && voice.env.isActive(); ++i) {
+                voiceBlock[i] = voice.render(noiseBlock[i]);
+            }
+            for (; i < chunk; ++i) {
+                voiceBlock[i] = 0.0f;
+            }
+//            Block is mixed into the left/right
 //            channel output using panLeft/panRight
 //            amount.
-                outputLeft += output * voice.panLeft;
-                outputRight += output * voice.panRight;
-            }
+            float gain = voice.pressureGain;
+            juce::FloatVectorOperations::addWithMultiply(outputLeft, voiceBlock, voice.panLeft * gain, chunk);
+            juce::FloatVectorOperations::addWithMultiply(outputRight, voiceBlock, voice.panRight * gain, chunk);
         }
         
 //        Adding all total volume.
 //        The smoother performs a linear interpolation between
-//        the previous value and the new value.
-        float outputLevel = outputLevelSmoother.getNextValue();
-        outputLeft *= outputLevel;
-        outputRight *= outputLevel;
-
-        
-//        Write output values into the respective audio buffer.
-        if (outputBufferRight != nullptr) {
-            outputBufferLeft[sample] = outputLeft;
-            outputBufferRight[sample] = outputRight;
+//        the previous value and the new value. Once it has
+//        arrived, the gain is the same for every sample.
+        if (outputLevelSmoother.isSmoothing()) {
+            for (int i = 0; i < chunk; ++i) {
+                gainBlock[i] = outputLevelSmoother.getNextValue();
+            }
+            juce::FloatVectorOperations::multiply(outputLeft, gainBlock, chunk);
+            juce::FloatVectorOperations::multiply(outputRight, gainBlock, chunk);
         } else {
-//            Case mono: left and right values need to be combined
-//            into a mono sample. No stereo.
-            outputBufferLeft[sample] = (outputLeft + outputRight) * .5f;
+            float outputLevel = outputLevelSmoother.getTargetValue();
+            juce::FloatVectorOperations::multiply(outputLeft, outputLevel, chunk);
+            juce::FloatVectorOperations::multiply(outputRight, outputLevel, chunk);
         }
+        
+//        Case mono: left and right values need to be combined
+//        into a mono sample. No stereo.
+        if (outputBufferRight == nullptr) {
+            juce::FloatVectorOperations::add(outputLeft, monoRight, chunk);
+            juce::FloatVectorOperations::multiply(outputLeft, 0.5f, chunk);
+        }
+        
+        sample += chunk;
     }
     
     for (int i = 0; i < MAX_VOICES; ++i) {
@@ -155,11 +195,6 @@ void Synth::render(float** outputBuffers, int sampleCount)
             voice.filter.reset();
         }
     }
-    
-    
-//        Mutes the audio for values beyond -2.0f and 2.0f
-    earProtect.protectYourEars(outputBufferLeft, sampleCount);
-    earProtect.protectYourEars(outputBufferRight, sampleCount);
 }
 
 void Synth::updateLFO() 
@@ -203,9 +238,16 @@ void Synth::updateLFO()
         for (int v = 0; v < MAX_VOICES; ++v) {
             Voice& voice = voices[v];
             if (voice.env.isActive()) {
+//                Per-note MPE values glide to their targets
+//                in a few milliseconds, so they don't zip.
+                voice.noteBend += MPE_SMOOTHING * (voice.noteBendTarget - voice.noteBend);
+                voice.notePressure += MPE_SMOOTHING * (voice.notePressureTarget - voice.notePressure);
+                voice.noteTimbre += MPE_SMOOTHING * (voice.noteTimbreTarget - voice.noteTimbre);
+                voice.pitchBend = pitchBend * voice.noteBend;
+                
                 voice.osc1.modulation = vibratoMod;
                 voice.osc2.modulation = pwm;
-                voice.filterMod = filterZip;
+                voice.filterMod = filterZip + voice.noteTimbre + voice.notePressure * sine;
 //                Get the new target period..
                 voice.updateLFO();
 //                ..and update it
@@ -231,7 +273,7 @@ bool Synth::isPlayingLegatoStyle() const
     return held > 0;
 }
 
-void Synth::startVoice(int v, int note, int velocity)
+void Synth::startVoice(int v, int note, float velocity)
 {
     float period = calcPeriod(v, note);
     Voice& voice = voices[v];
@@ -290,9 +332,11 @@ void Synth::startVoice(int v, int note, int velocity)
     lastNote = note;
     voice.note = note;
     voice.updatePanning();
+    noteVoices[size_t(note)] = v;
+    voice.keyPressureTarget = voice.keyPressure = 0.0f;
     
 //    Changing the velocity from a linear to a logarithmic curve.
-    float vel = .004f * float((velocity + 64) * (velocity + 64)) - 8.0f;
+    float vel = .004f * (velocity + 64.0f) * (velocity + 64.0f) - 8.0f;
     voice.osc1.amplitude = vel * volumeTrim;
     voice.osc2.amplitude = voice.osc1.amplitude * oscMix;
     
@@ -312,7 +356,7 @@ void Synth::startVoice(int v, int note, int velocity)
 //    Same when velocitySensitivity is 0.
 //    Range is 1/24 - 24. It’s  like ±55 semitones.
 //    Up and down by four-and-a-half octaves.
-    voice.cutoff *= std::exp(velocitySensitivity * float(velocity - 64));
+    voice.cutoff *= std::exp(velocitySensitivity * (velocity - 64.0f));
     
     
     
@@ -326,7 +370,7 @@ void Synth::startVoice(int v, int note, int velocity)
     
 }
 
-void Synth::restartMonoVoice(int note, int velocity)
+void Synth::restartMonoVoice(int note, float velocity)
 {
     float period = calcPeriod(0, note);
     
@@ -344,20 +388,22 @@ void Synth::restartMonoVoice(int note, int velocity)
     voice.env.level += SILENCE + SILENCE;
     voice.note = note;
     voice.updatePanning();
+    noteVoices[size_t(note)] = 0;
+    voice.keyPressureTarget = voice.keyPressure = 0.0f;
     
     voice.cutoff = sampleRate / (period * PI);
-    if (velocity > 0) {
-        voice.cutoff *= std::exp(velocitySensitivity * float(velocity - 64));
+    if (velocity > 0.0f) {
+        voice.cutoff *= std::exp(velocitySensitivity * (velocity - 64.0f));
     }
 
 }
 
-void Synth::noteON(int note, int velocity)
+int Synth::noteON(int note, float velocity)
 {
     if (ignoreVelocity) {
 //        Disabling velocity modulation
 //        by setting a fixed value.
-        velocity = 80;
+        velocity = 80.0f;
     } else {
 //    Velocity sensitivity for the amplitude. Not an
 //    official part of the original JX11.
@@ -380,7 +426,7 @@ void Synth::noteON(int note, int velocity)
             shiftQueuedNotes();
 //            Call the method for legato-style playing.
             restartMonoVoice(note, velocity);
-            return;
+            return 0;
         }
 //        Otherwise polyphonic
     } else {
@@ -388,6 +434,7 @@ void Synth::noteON(int note, int velocity)
     }
     
     startVoice(v, note, velocity);
+    return v;
 }
 
 int Synth::findFreeVoice() const 
@@ -417,7 +464,7 @@ void Synth::noteOff(int note)
 //        Is player still holding down any keys
         if (queuedNote > 0) {
 //            Change the pitch
-            restartMonoVoice(queuedNote, -1);
+            restartMonoVoice(queuedNote, -1.0f);
         }
     }
     
@@ -478,40 +525,51 @@ int Synth::nextQueuedNote()
 
 
 //==============================================================================
-void Synth::midiMessage(uint8_t data0, uint8_t data1, uint8_t data2)
+void Synth::midiEvent(const MidiEvent& event)
 {
-//    Consider only the four highest bits (command)
-    switch (data0& 0xF0) {
+//    In MPE mode the member channels control their own note.
+    if (mpeEnabled && event.channel > 0 && mpeEvent(event)) {
+        return;
+    }
+    
+//    The values have 32 bits. asMidi1() gives them on the
+//    familiar 0 - 127 scale, with the fractions in between.
+    switch (event.status) {
 //            Note off
         case 0x80: {
-            noteOff(data1& 0x7F);
+            noteOff(event.index);
             break;
         }
-//            Note on
+//            Note on. A Note On with velocity 0 is
+//            already a Note Off in MidiEvent.
         case 0x90: {
-            uint8_t note = data1& 0x7F;
-            uint8_t velo = data2& 0x7F;
-            
-            if (velo > 0) {
-                noteON(note, velo);
-            } else {
-                noteOff(note);
-            }
+//            Not an MPE note, so no per-note values.
+            setVoiceChannel(noteON(event.index, event.asMidi1()), -1);
             break;
         }
 //            Pitch bend
         case 0xE0: {
-//            In Pitch bend data1 and data2 are combined.
-//            It results in a 14-bit number in a a range of
+//            In MIDI 1.0 pitch bend is a 14-bit number in a range of
 //            0 – 16383 if unsigned or –8192 to 8191 signed.
-//            (data1 + 128 * data2 - 8192)
+//            (data1 + 128 * data2 - 8192). bipolar() * 8192
+//            is the same range, in finer steps.
             
 //            Range to make the pitch rise  in 2 semitones
 //            2^2/12 = 1.12. Lower 2 semitones is 0.89.
 //            By changing the period it is inverse.
 //            Mapping: –8192 to 8191 into 1.12 – 0.89.
 //            Origin formula: 2^2*(data/8192)/12
-            pitchBend = std::exp(-0.000014102f * float(data1 + 128 * data2 - 8192));
+            pitchBend = std::exp(-0.000014102f * event.bipolar() * 8192.0f);
+            break;
+        }
+//            Polyphonic aftertouch. The index finds the
+//            voice of the key without searching for it.
+        case 0xA0: {
+            int note = event.index;
+            int v = noteVoices[size_t(note)];
+            if (v >= 0 && voices[size_t(v)].note == note) {
+                voices[size_t(v)].keyPressureTarget = event.unipolar();
+            }
             break;
         }
 //            Channel aftertouch
@@ -519,21 +577,141 @@ void Synth::midiMessage(uint8_t data0, uint8_t data1, uint8_t data2)
 //            Additional depth to the LFO.
 //            Maps the pressure value to a parabolic curve
 //            starting at 0.0 (position 0) up to 1.61 (position 127).
-            pressure = 0.0001f * float(data1 * data1);
+            float value = event.asMidi1();
+            pressure = 0.0001f * value * value;
             break;
         }
 //            Control change
         case 0xB0: {
-            controlChange(data1, data2);
+            controlChange(event);
             break;
         }
     }
 }
 
-void Synth::controlChange(uint8_t data1, uint8_t data2)
+bool Synth::mpeEvent(const MidiEvent& event)
 {
-//    data1 determines the type of controller
-//    data 2 the value (0-127)
+    int channel = event.channel;
+    MPEChannel& mpe = mpeChannels[size_t(channel)];
+    Voice* voice = (mpe.voice >= 0) ? &voices[size_t(mpe.voice)] : nullptr;
+    
+    switch (event.status) {
+//            Note on. The voice takes over the channel.
+        case 0x90: {
+            setVoiceChannel(noteON(event.index, event.asMidi1()), channel);
+            return true;
+        }
+//            Per-note pitch bend. MPE uses a range
+//            of 48 semitones on the member channels.
+//            0.05776226505 * 48 / 8192 = 0.00033845.
+        case 0xE0: {
+            mpe.bend = std::exp(-0.00033845f * event.bipolar() * 8192.0f);
+            if (voice != nullptr) {
+                voice->noteBendTarget = mpe.bend;
+            }
+            return true;
+        }
+//            Per-note pressure, the same curve
+//            as channel aftertouch.
+        case 0xD0: {
+            float value = event.asMidi1();
+            mpe.pressure = 0.0001f * value * value;
+            if (voice != nullptr) {
+                voice->notePressureTarget = mpe.pressure;
+            }
+            return true;
+        }
+//            Per-note timbre (CC 74), the same
+//            amount as the 0x4A filter controller.
+        case 0xB0: {
+            if (event.index != 0x4A) {
+                return false;
+            }
+            mpe.timbre = .02f * event.asMidi1();
+            if (voice != nullptr) {
+                voice->noteTimbreTarget = mpe.timbre;
+            }
+            return true;
+        }
+    }
+    
+//    Note off. Only the voice that belongs to the channel is
+//    released, even if another channel plays the same note number.
+//    The Note Off is used up either way: if the voice was stolen,
+//    the note has already ended and there's nothing left to do.
+    if (event.status == 0x80) {
+        if (voice != nullptr && voice->note == event.index) {
+            mpeNoteOff(*voice);
+        } else if (numVoices == 1) {
+//            In mono mode the key may still wait in the queue
+//            behind the note that took over the voice.
+            for (int i = 1; i < MAX_VOICES; ++i) {
+                if (voices[i].note == event.index) {
+                    voices[i].note = 0;
+                    break;
+                }
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+void Synth::mpeNoteOff(Voice& voice)
+{
+//    Last note priority, the same as noteOff(). The queued
+//    note doesn't know its channel, so it plays without
+//    per-note expression.
+    if (numVoices == 1) {
+        int queuedNote = nextQueuedNote();
+        if (queuedNote > 0) {
+            restartMonoVoice(queuedNote, -1.0f);
+            setVoiceChannel(0, -1);
+            return;
+        }
+    }
+    
+    if (sustainPedalPressed) {
+        voice.note = SUSTAIN;
+    } else {
+        voice.release();
+        voice.note = 0;
+    }
+}
+
+void Synth::setVoiceChannel(int v, int channel)
+{
+    Voice& voice = voices[size_t(v)];
+    
+//    A stolen voice no longer belongs to its old channel.
+    if (voice.channel >= 0 && mpeChannels[size_t(voice.channel)].voice == v) {
+        mpeChannels[size_t(voice.channel)].voice = -1;
+    }
+    voice.channel = channel;
+    
+//    The note starts right at the values that were sent on its
+//    channel before the Note On, without gliding to them.
+    float bend = 1.0f;
+    float notePressure = 0.0f;
+    float timbre = 0.0f;
+    if (channel >= 0) {
+        MPEChannel& mpe = mpeChannels[size_t(channel)];
+        mpe.voice = v;
+        bend = mpe.bend;
+        notePressure = mpe.pressure;
+        timbre = mpe.timbre;
+    }
+    voice.noteBendTarget = voice.noteBend = bend;
+    voice.notePressureTarget = voice.notePressure = notePressure;
+    voice.noteTimbreTarget = voice.noteTimbre = timbre;
+}
+
+void Synth::controlChange(const MidiEvent& event)
+{
+//    event.index determines the type of controller,
+//    value the position (0-127, with fractions).
+    int data1 = event.index;
+    float value = event.asMidi1();
     switch (data1) {
 //            Sustain pedal
         case 0x40: {
@@ -542,7 +720,7 @@ void Synth::controlChange(uint8_t data1, uint8_t data2)
 //            pedals output off (0) on (127). This calc-
 //            ulation also considers pedals with contiuous
 //            values.
-            sustainPedalPressed = (data2 >= 64);
+            sustainPedalPressed = (value >= 64.0f);
             
 //            Release note if the pedal isn't pressed
 //            anymore.
@@ -556,28 +734,19 @@ void Synth::controlChange(uint8_t data1, uint8_t data2)
 //            Values converted to a parabolic curve in
 //            order to gain more control over small values.
 //            0 maps to 0 and 127 to 0.0806.
-            modWheel = 0.000005f * float(data2 * data2);
+            modWheel = 0.000005f * value * value;
             break;
         }
-         /*
-        case 0x47: {
-//            Maps the position of the controller (0 – 127)
-//            to a linear curve between 1.0 and 5.7 which
-//            add an extra boost to the value from the
-//            Filter Reso parameter.
-            resonanceCtl = 154.0f / float(154 - data2);
-            break;
-        }*/
 //            Filter in positive direction.
 //            Turns cutoff higher.
         case 0x4A: {
-            filterCtl = .02f * float(data2);
+            filterCtl = .02f * value;
             break;
         }
 //            Filter in negative direction.
 //            Turns cutoff lower:
         case 0x4B: {
-            filterCtl = -.03f * float(data2);
+            filterCtl = -.03f * value;
             break;
         }
             
@@ -593,17 +762,59 @@ void Synth::controlChange(uint8_t data1, uint8_t data2)
             }
             break;
     }
-    
-//    Resonance for MIDI Learn Mode
-    if (data1 == resoCC) {
-//        Maps the position of the controller (0 – 127)
-//        to a linear curve between 1.0 and 5.7 which
-//        add an extra boost to the value from the
-//        Filter Reso parameter.
-        resonanceCtl = 154.0f / float(154 - data2);
+}
 
+void Synth::releaseAll()
+{
+    sustainPedalPressed = false;
+    for (int i = 0; i < MAX_VOICES; ++i) {
+        voices[i].release();
+        voices[i].note = 0;
     }
-    
+}
+
+bool Synth::isPlaying() const
+{
+    for (int i = 0; i < MAX_VOICES; ++i) {
+        if (voices[i].env.isActive()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Synth::applyParams(const SynthParams& params)
+{
+    noiseMix = params.noiseMix;
+    envAttack = params.envAttack;
+    envDecay = params.envDecay;
+    envSustain = params.envSustain;
+    envRelease = params.envRelease;
+    oscMix = params.oscMix;
+    detune = params.detune;
+    tune = params.tune;
+    numVoices = params.numVoices;
+    velocitySensitivity = params.velocitySensitivity;
+    ignoreVelocity = params.ignoreVelocity;
+    lfoInc = params.lfoInc;
+    vibrato = params.vibrato;
+    pwmDepth = params.pwmDepth;
+    glideMode = params.glideMode;
+    glideRate = params.glideRate;
+    glideBend = params.glideBend;
+    filterKeyTracking = params.filterKeyTracking;
+    filterQ = params.filterQ;
+    volumeTrim = params.volumeTrim;
+    filterLFODepth = params.filterLFODepth;
+    filterAttack = params.filterAttack;
+    filterDecay = params.filterDecay;
+    filterSustain = params.filterSustain;
+    filterRelease = params.filterRelease;
+    filterEnvDepth = params.filterEnvDepth;
+    
+//    Does a linear interpolation over 0.05 seconds from the
+//    current value to this new target.
+    outputLevelSmoother.setTargetValue(params.outputLevel);
 }
 
 //==============================================================================
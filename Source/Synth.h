@@ -28,6 +28,8 @@
 #include "Voice.h"
 #include "NoiseGenerator.h"
 #include "Utils.h"
+#include "SynthParams.h"
+#include "MidiEvent.h"
 
 
 class Synth {
@@ -52,14 +54,15 @@ public:
 //    render current block of audio. Making sound.
     void render(float** outputBuffers, int sampleCount);
     
-//    Handling MIDI messages
-    void midiMessage(uint8_t data0, uint8_t data1, uint8_t data2);
+//    Handling MIDI messages, MIDI 1.0 or 2.0.
+    void midiEvent(const MidiEvent& event);
     
 //    Renders the period for a given MIDI note number.
     float calcPeriod(int, int) const;
     
 //    Setting up the voice with envelope and oscillators
-    void startVoice(int v, int note, int velocity);
+//    Velocity goes from 0 to 127, with fractions from high-resolution input.
+    void startVoice(int v, int note, float velocity);
     
 //    Find free voices for chords.
 //    When all voices are in use, the synthesizer needs to
@@ -68,7 +71,22 @@ public:
     int findFreeVoice() const;
     
 //    Processes various MIDI CC commands
-    void controlChange(uint8_t data1, uint8_t data2);
+    void controlChange(const MidiEvent& event);
+    
+//    Puts every voice into its release phase, ignoring the
+//    sustain pedal. Used when the engine is switched off
+//    during a preset change and should fade out on its own.
+    void releaseAll();
+    
+//    True as long as at least one voice is still audible.
+    bool isPlaying() const;
+    
+//    Read access for the voice monitor.
+    const Voice& getVoice(int v) const { return voices[size_t(v)]; }
+    
+//    Copies the values calculated by the processor
+//    into the public member variables below.
+    void applyParams(const SynthParams& params);
     
 //    ------------------------------------------------------------------
 //    Public member variables
@@ -120,7 +138,7 @@ public:
     bool ignoreVelocity;
     
 //    The update rate for the LFO is once every 32 samples.
-    const int LFO_MAX = 32;
+    static constexpr int LFO_MAX = 32;
 //    Phase increment for the LFO (0-2PI)
     float lfoInc;
     
@@ -159,10 +177,11 @@ public:
 //    Modulation intensity for the envelope.
     float filterEnvDepth;
     
-//    Checking for any MIDI CC number for the
-//    resonance modulation.
-//    Default: MIDI CC number of 0x47.
-    uint8_t resoCC = 0x47;
+//    MPE with a lower zone: channel 1 is the master channel and
+//    affects all notes, channels 2 to 16 are member channels. Pitch
+//    bend, channel pressure and CC 74 on a member channel only change
+//    the note that is playing on that channel.
+    bool mpeEnabled = false;
     
 private:
     
@@ -172,18 +191,41 @@ private:
 
     float sampleRate;
     
-    void noteON(int, int);
+//    Returns the voice that plays the note.
+    int noteON(int, float);
     void noteOff(int);
     
+//    MPE state of a member channel: the voice that plays its note,
+//    or -1, and the last values received on it. Looking up the voice
+//    this way takes the same time no matter how many notes play.
+    struct MPEChannel {
+        int voice = -1;
+        float bend = 1.0f;
+        float pressure = 0.0f;
+        float timbre = 0.0f;
+    };
+    std::array<MPEChannel, 16> mpeChannels;
+    
+//    The voice that last started each MIDI note, for polyphonic
+//    aftertouch. An entry is only used while the voice still
+//    plays that note, so it never has to be cleared.
+    std::array<int, 128> noteVoices;
+    
+//    Gives voice v to a member channel, or takes it away if
+//    channel is -1. The note starts with the channel's values.
+    void setVoiceChannel(int v, int channel);
+//    Notes, pitch bend, pressure and CC 74 on a member channel.
+//    Returns false for the messages that affect all notes.
+    bool mpeEvent(const MidiEvent& event);
+//    Releases the voice of a member channel and no other.
+    void mpeNoteOff(Voice& voice);
+    
 //    Multiple voices for each note playing.
     std::array<Voice, MAX_VOICES>  voices;
     
 //    Mixing noise to the oscillator.
     NoiseGenerator noiseGen;
     
-//    Mutes the audio for ear protection.
-    Utils earProtect;
-    
 //    Sustain pedal
     bool sustainPedalPressed;
     
@@ -203,9 +245,6 @@ private:
 //    gliding from.
     int lastNote;
     
-//    Control the amount of resonance with a knob
-    float resonanceCtl;
-    
 //    Aftertouch
     float pressure;
     
@@ -223,7 +262,7 @@ private:
     
 //    Legato playing. Continues the envelope and
 //    only changes the pitch of the tone.
-    void restartMonoVoice(int note, int velocity);
+    void restartMonoVoice(int note, float velocity);
     
 //    Last note priority. Shifts all the queued notes
 //    one position down while holding them all.
@@ -236,7 +275,7 @@ private:
 //    New period has to be updated.
     void updatePeriod(Voice& voice)
     {
-        voice.osc1.period = voice.period * pitchBend;
+        voice.osc1.period = voice.period * pitchBend * voice.noteBend;
         voice.osc2.period = voice.osc1.period * detune;
     }
     
@@ -0,0 +1,124 @@
+/*
+  ==============================================================================
+
+    SynthParams.h
+    Created: 18 Oct 2026 1:24:09pm
+    Author:  MacJay
+
+    The values that the processor derives from its 26 parameters and hands
+    to class Synth. Many of them are envelope or filter multipliers that
+    need std::exp and friends, so calculating them is the expensive part
+    of JX11AudioProcessor::update().
+
+    Keeping them in one struct lets the preset morph precalculate them
+    for a number of points between two presets and blend neighbouring
+    points, which costs a few multiplications instead of a full update().
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "Preset.h"
+
+//Indices into Preset::param, in the order of the Preset constructor.
+enum ParamIndex {
+    OSC_MIX = 0,
+    OSC_TUNE,
+    OSC_FINE,
+    GLIDE_MODE,
+    GLIDE_RATE,
+    GLIDE_BEND,
+    FILTER_FREQ,
+    FILTER_RESO,
+    FILTER_ENV,
+    FILTER_LFO,
+    FILTER_VELOCITY,
+    FILTER_ATTACK,
+    FILTER_DECAY,
+    FILTER_SUSTAIN,
+    FILTER_RELEASE,
+    ENV_ATTACK,
+    ENV_DECAY,
+    ENV_SUSTAIN,
+    ENV_RELEASE,
+    LFO_RATE,
+    VIBRATO,
+    NOISE,
+    OCTAVE,
+    TUNING,
+    OUTPUT_LEVEL,
+    POLY_MODE,
+};
+
+static_assert(POLY_MODE == NUM_PARAMS - 1, "ParamIndex doesn't match NUM_PARAMS");
+
+struct SynthParams {
+    float noiseMix = 0.0f;
+    float envAttack = 0.0f;
+    float envDecay = 0.0f;
+    float envSustain = 0.0f;
+    float envRelease = 0.0f;
+    float oscMix = 0.0f;
+    float detune = 1.0f;
+    float tune = 0.0f;
+    int numVoices = 1;
+//    Linear gain, the target of Synth::outputLevelSmoother.
+    float outputLevel = 1.0f;
+    float velocitySensitivity = 0.0f;
+    bool ignoreVelocity = false;
+    float lfoInc = 0.0f;
+    float vibrato = 0.0f;
+    float pwmDepth = 0.0f;
+    int glideMode = 0;
+    float glideRate = 1.0f;
+    float glideBend = 0.0f;
+    float filterKeyTracking = 0.0f;
+    float filterQ = 1.0f;
+    float volumeTrim = 0.0f;
+    float filterLFODepth = 0.0f;
+    float filterAttack = 0.0f;
+    float filterDecay = 0.0f;
+    float filterSustain = 0.0f;
+    float filterRelease = 0.0f;
+    float filterEnvDepth = 0.0f;
+
+//    Blends two sets of values, t goes from 0 (a) to 1 (b).
+//    Settings that can't be in between, such as the number
+//    of voices, switch over halfway.
+    static SynthParams interpolate(const SynthParams& a, const SynthParams& b, float t)
+    {
+        auto mix = [t](float x, float y) { return x + (y - x) * t; };
+        const SynthParams& nearest = (t < 0.5f) ? a : b;
+
+        SynthParams p;
+        p.noiseMix = mix(a.noiseMix, b.noiseMix);
+        p.envAttack = mix(a.envAttack, b.envAttack);
+        p.envDecay = mix(a.envDecay, b.envDecay);
+        p.envSustain = mix(a.envSustain, b.envSustain);
+        p.envRelease = mix(a.envRelease, b.envRelease);
+        p.oscMix = mix(a.oscMix, b.oscMix);
+        p.detune = mix(a.detune, b.detune);
+        p.tune = mix(a.tune, b.tune);
+        p.numVoices = nearest.numVoices;
+        p.outputLevel = mix(a.outputLevel, b.outputLevel);
+        p.velocitySensitivity = mix(a.velocitySensitivity, b.velocitySensitivity);
+        p.ignoreVelocity = nearest.ignoreVelocity;
+        p.lfoInc = mix(a.lfoInc, b.lfoInc);
+        p.vibrato = mix(a.vibrato, b.vibrato);
+        p.pwmDepth = mix(a.pwmDepth, b.pwmDepth);
+        p.glideMode = nearest.glideMode;
+        p.glideRate = mix(a.glideRate, b.glideRate);
+        p.glideBend = mix(a.glideBend, b.glideBend);
+        p.filterKeyTracking = mix(a.filterKeyTracking, b.filterKeyTracking);
+        p.filterQ = mix(a.filterQ, b.filterQ);
+        p.volumeTrim = mix(a.volumeTrim, b.volumeTrim);
+        p.filterLFODepth = mix(a.filterLFODepth, b.filterLFODepth);
+        p.filterAttack = mix(a.filterAttack, b.filterAttack);
+        p.filterDecay = mix(a.filterDecay, b.filterDecay);
+        p.filterSustain = mix(a.filterSustain, b.filterSustain);
+        p.filterRelease = mix(a.filterRelease, b.filterRelease);
+        p.filterEnvDepth = mix(a.filterEnvDepth, b.filterEnvDepth);
+        return p;
+    }
+};
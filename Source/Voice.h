@@ -68,11 +68,33 @@ struct Voice {
     
 //    Adding filter envelopes.
     Envelope filterEnv;
+//    Cutoff after all modulation, as last sent to the filter.
+//    Kept for the voice monitor.
+    float modulatedCutoff = 0.0f;
     float filterEnvDepth;
     
 //    Amount of pitch bend in the filter modulation.
     float pitchBend;
     
+//    MPE: the member channel that plays this note, or -1.
+    int channel = -1;
+//    Per-note pitch bend (as a period multiplier), pressure and
+//    timbre. The targets are set by MIDI, the values follow them
+//    smoothly at the LFO rate.
+    float noteBendTarget = 1.0f;
+    float noteBend = 1.0f;
+    float notePressureTarget = 0.0f;
+    float notePressure = 0.0f;
+    float noteTimbreTarget = 0.0f;
+    float noteTimbre = 0.0f;
+    
+//    Polyphonic aftertouch on this note, 0 - 1. Opens the filter
+//    and makes the note louder. The gain is applied when the voice
+//    is mixed into the output, so it costs nothing per sample.
+    float keyPressureTarget = 0.0f;
+    float keyPressure = 0.0f;
+    float pressureGain = 1.0f;
+    
 //    On initialization of the plug-in
 //    reset note and velocity
     void reset() {
@@ -89,6 +111,13 @@ struct Voice {
         panRight = 0.707f;
         filter.reset();
         filterEnv.reset();
+        modulatedCutoff = 0.0f;
+        channel = -1;
+        noteBendTarget = noteBend = 1.0f;
+        notePressureTarget = notePressure = 0.0f;
+        noteTimbreTarget = noteTimbre = 0.0f;
+        keyPressureTarget = keyPressure = 0.0f;
+        pressureGain = 1.0f;
     }
     
 //    Time to release the note.
@@ -109,13 +138,21 @@ struct Voice {
 //        Gets the filter envelope’s current level (0 - 1).
         float fenv = filterEnv.nextValue();
         
+//        Aftertouch glides to its target at the
+//        same rate as the MPE values.
+        keyPressure += 0.2f * (keyPressureTarget - keyPressure);
+//        Up to +3.5 dB.
+        pressureGain = 1.0f + 0.5f * keyPressure;
+        
 //        A multiplier that makes cutoff higher or lower.
 //        From exp(-1.5) = 0.22× to exp(6.5) = 665×.
 //        Freq = 18,75% equals the cutoff frequency.
 //        Freq = 33% is on the pitch of the note.
 //        Freq = 90%. No influence of the filter.
 //        Multiply by filter env.
-        float modulatedCutoff = cutoff * std::exp(filterMod + filterEnvDepth * fenv) / pitchBend;
+//        Full aftertouch raises the cutoff by about two octaves.
+        modulatedCutoff = cutoff * std::exp(filterMod + filterEnvDepth * fenv
+                                            + 1.5f * keyPressure) / pitchBend;
 //        Limit the cutoff to a reasonable range between
 //        30 Hz and 20000 Hz.
         modulatedCutoff = std::clamp(modulatedCutoff, 30.0f, 20000.0f);
@@ -0,0 +1,108 @@
+/*
+  ==============================================================================
+
+    VoiceMonitor.h
+    Created: 18 Oct 2026 5:11:38pm
+    Author:  MacJay
+
+    Publishes the state of every voice once per block, so the editor can
+    show what the voices are doing (and watch voice stealing).
+
+    The audio thread must never wait for the editor, so this is a
+    seqlock: the writer makes the sequence number odd, writes the values
+    and makes it even again. The reader copies the values and checks
+    that the sequence number was even and didn't change meanwhile;
+    otherwise it tries again. The values themselves are relaxed atomics,
+    so the copy is never a data race, only possibly inconsistent, which
+    the sequence number catches.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "Synth.h"
+
+struct VoiceSnapshot {
+    int note = 0;
+    Envelope::Stage stage = Envelope::IDLE;
+    float level = 0.0f;
+    float cutoff = 0.0f;
+    float filterEnvLevel = 0.0f;
+};
+
+class VoiceMonitor
+{
+public:
+    using Snapshot = std::array<VoiceSnapshot, Synth::MAX_VOICES>;
+
+//    Audio thread, once per block. Only checks a flag
+//    while the editor isn't showing the voices.
+    void publish(const Synth& synth)
+    {
+        if (!enabled.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        sequence.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (int v = 0; v < Synth::MAX_VOICES; ++v) {
+            const Voice& voice = synth.getVoice(v);
+            VoiceData& data = voices[size_t(v)];
+            data.note.store(voice.note, std::memory_order_relaxed);
+            data.stage.store(int(voice.env.getStage()), std::memory_order_relaxed);
+            data.level.store(voice.env.level, std::memory_order_relaxed);
+            data.cutoff.store(voice.modulatedCutoff, std::memory_order_relaxed);
+            data.filterEnvLevel.store(voice.filterEnv.level, std::memory_order_relaxed);
+        }
+
+        sequence.fetch_add(1, std::memory_order_release);
+    }
+
+//    Message thread. Returns false if the audio thread kept
+//    writing during every attempt; just try again next time.
+    bool read(Snapshot& snapshot) const
+    {
+        for (int attempt = 0; attempt < 4; ++attempt) {
+            uint32_t before = sequence.load(std::memory_order_acquire);
+            if ((before & 1) != 0) {
+                continue;
+            }
+
+            for (size_t v = 0; v < snapshot.size(); ++v) {
+                const VoiceData& data = voices[v];
+                snapshot[v].note = data.note.load(std::memory_order_relaxed);
+                snapshot[v].stage = Envelope::Stage(data.stage.load(std::memory_order_relaxed));
+                snapshot[v].level = data.level.load(std::memory_order_relaxed);
+                snapshot[v].cutoff = data.cutoff.load(std::memory_order_relaxed);
+                snapshot[v].filterEnvLevel = data.filterEnvLevel.load(std::memory_order_relaxed);
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == before) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void setEnabled(bool shouldBeEnabled)
+    {
+        enabled.store(shouldBeEnabled);
+    }
+
+private:
+    struct VoiceData {
+        std::atomic<int> note {0};
+        std::atomic<int> stage {0};
+        std::atomic<float> level {0.0f};
+        std::atomic<float> cutoff {0.0f};
+        std::atomic<float> filterEnvLevel {0.0f};
+    };
+
+    std::atomic<bool> enabled {false};
+    std::atomic<uint32_t> sequence {0};
+    std::array<VoiceData, Synth::MAX_VOICES> voices;
+};
@@ -0,0 +1,80 @@
+/*
+  ==============================================================================
+
+    VoiceView.cpp
+    Created: 18 Oct 2026 5:11:38pm
+    Author:  MacJay
+
+  ==============================================================================
+*/
+
+#include "VoiceView.h"
+
+VoiceView::VoiceView(VoiceMonitor& monitor_) : monitor(monitor_)
+{
+    setOpaque(true);
+    monitor.setEnabled(true);
+    startTimerHz(30);
+}
+
+VoiceView::~VoiceView()
+{
+    stopTimer();
+    monitor.setEnabled(false);
+}
+
+void VoiceView::timerCallback()
+{
+    if (monitor.read(snapshot)) {
+        repaint();
+    }
+}
+
+//Draws a horizontal bar for a value between 0 and 1.
+static void drawBar(juce::Graphics& g, juce::Rectangle<float> area, float value, juce::Colour colour)
+{
+    g.setColour(juce::Colour(65, 70, 80));
+    g.fillRect(area);
+    g.setColour(colour);
+    g.fillRect(area.withWidth(area.getWidth() * juce::jlimit(0.0f, 1.0f, value)));
+}
+
+void VoiceView::paint(juce::Graphics& g)
+{
+    g.fillAll(juce::Colour(15, 30, 45));
+    g.setFont(13.0f);
+
+    static const char* stageNames[] = { "-", "Attack", "Decay", "Release" };
+
+    auto bounds = getLocalBounds().reduced(4);
+    int rowHeight = bounds.getHeight() / int(snapshot.size());
+
+    for (size_t v = 0; v < snapshot.size(); ++v) {
+        const VoiceSnapshot& voice = snapshot[v];
+        auto row = bounds.removeFromTop(rowHeight).reduced(0, 2);
+        bool active = voice.stage != Envelope::IDLE;
+
+        g.setColour(active ? juce::Colours::white : juce::Colour(100, 100, 100));
+        g.drawText(juce::String(int(v) + 1), row.removeFromLeft(20), juce::Justification::centredLeft);
+//        The note number stays set after the key is released.
+        juce::String note = (voice.note > 0) ? juce::MidiMessage::getMidiNoteName(voice.note, true, true, 4) : "-";
+        g.drawText(note, row.removeFromLeft(50), juce::Justification::centredLeft);
+        g.drawText(stageNames[voice.stage], row.removeFromLeft(60), juce::Justification::centredLeft);
+
+        if (!active) {
+            continue;
+        }
+
+//        Envelope level.
+        auto levelArea = row.removeFromLeft(row.getWidth() / 3).reduced(4, 1).toFloat();
+        drawBar(g, levelArea, voice.level, juce::Colours::orange);
+
+//        Cutoff on a logarithmic scale from 30 Hz to 20 kHz.
+        auto cutoffArea = row.removeFromLeft(row.getWidth() / 2).reduced(4, 1).toFloat();
+        float cutoff = std::log(juce::jmax(30.0f, voice.cutoff) / 30.0f) / std::log(20000.0f / 30.0f);
+        drawBar(g, cutoffArea, cutoff, juce::Colours::lightblue);
+
+        auto filterEnvArea = row.reduced(4, 1).toFloat();
+        drawBar(g, filterEnvArea, voice.filterEnvLevel, juce::Colours::lightgreen);
+    }
+}
@@ -0,0 +1,35 @@
+/*
+  ==============================================================================
+
+    VoiceView.h
+    Created: 18 Oct 2026 5:11:38pm
+    Author:  MacJay
+
+    One row per voice: note, envelope stage, envelope level, filter
+    cutoff and filter envelope level. Reads VoiceMonitor on a timer.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "VoiceMonitor.h"
+
+class VoiceView : public juce::Component,
+                  private juce::Timer
+{
+public:
+    explicit VoiceView(VoiceMonitor& monitor);
+    ~VoiceView() override;
+
+    void paint(juce::Graphics& g) override;
+
+private:
+    void timerCallback() override;
+
+    VoiceMonitor& monitor;
+    VoiceMonitor::Snapshot snapshot;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (VoiceView)
+};
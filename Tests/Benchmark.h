@@ -0,0 +1,42 @@
+/*
+  ==============================================================================
+
+    Benchmark.h
+    Created: 18 Oct 2026 10:31:12pm
+    Author:  MacJay
+
+    Timing for the benchmarks in the test app. They're unit tests too,
+    in the category "JX11", and log their results with logMessage().
+    The app is built with the realtime checks, which add a thread check
+    to every allocation, so the numbers are best compared with each
+    other rather than read as absolute times.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <limits>
+
+//Calls function the given number of times and returns how long the
+//calls took. PerformanceCounter would print its own statistics every
+//so many runs, that's turned off here.
+template <typename Function>
+juce::PerformanceCounter::Statistics measure(const juce::String& name, int runs, Function&& function)
+{
+    juce::PerformanceCounter counter(name, std::numeric_limits<int>::max());
+    for (int i = 0; i < runs; ++i) {
+        counter.start();
+        function();
+        counter.stop();
+    }
+    return counter.getStatisticsAndReset();
+}
+
+//How many times faster the fast statistics are than the slow ones.
+inline juce::String speedUp(const juce::PerformanceCounter::Statistics& slow,
+                            const juce::PerformanceCounter::Statistics& fast)
+{
+    return juce::String(slow.averageSeconds / juce::jmax(fast.averageSeconds, 1e-12), 1);
+}
@@ -0,0 +1,153 @@
+/*
+  ==============================================================================
+
+    EditorBenchmark.cpp
+    Created: 18 Oct 2026 11:04:18pm
+    Author:  MacJay
+
+    Painting times of the editor, measured by painting into a
+    juce::Image with the software renderer, so no window is needed.
+
+    Knob repaint: a RotaryKnob repainted with a new value each time,
+    the way a knob repaints while it's turned or automated. It's
+    measured with the background arc cached (LookAndFeel), with the
+    cache emptied before each repaint and with JUCE's LookAndFeel_V4.
+
+    Editor repaint: the whole editor painted by the software renderer,
+    the work the OpenGL mode moves to the GPU. The OpenGL mode itself
+    needs a window and a graphics card, so it isn't measured here.
+
+    Editor open: createEditor() and the first paint of the editor, the
+    time between clicking the plug-in in the host and seeing it. The
+    panels below the fold are built later, when they scroll into view.
+
+  ==============================================================================
+*/
+
+#include "../Source/PluginProcessor.h"
+#include "../Source/RotaryKnob.h"
+#include "../Source/LookAndFeel.h"
+#include "Benchmark.h"
+
+class KnobBenchmark : public juce::UnitTest
+{
+public:
+    KnobBenchmark() : juce::UnitTest("Knob benchmark", "JX11") {}
+
+    void runTest() override
+    {
+        constexpr int runs = 2000;
+
+//        The size of the knobs in the editor.
+        RotaryKnob knob;
+        knob.setSize(90, 120);
+        juce::Image image(juce::Image::ARGB, knob.getWidth(), knob.getHeight(), true);
+
+        int step = 0;
+        auto repaint = [&] {
+            knob.slider.setValue(double(step++ % 11), juce::dontSendNotification);
+            juce::Graphics g(image);
+            knob.paintEntireComponent(g, false);
+        };
+
+        beginTest("Cached arc");
+        LookAndFeel lookAndFeel;
+        knob.setLookAndFeel(&lookAndFeel);
+        repaint();
+        auto cached = measure("Knob repaint, cached arc", runs, repaint);
+        logMessage(cached.toString());
+
+        beginTest("Arc drawn every time");
+        juce::SharedResourcePointer<SharedResources> shared;
+        auto uncached = measure("Knob repaint, arc drawn every time", runs, [&] {
+            shared->knobImages.clear();
+            repaint();
+        });
+        logMessage(uncached.toString());
+        expect(cached.averageSeconds < uncached.averageSeconds, "The cached arc is not faster");
+
+        beginTest("LookAndFeel_V4");
+        juce::LookAndFeel_V4 juceLookAndFeel;
+        knob.setLookAndFeel(&juceLookAndFeel);
+        auto plain = measure("Knob repaint, LookAndFeel_V4", runs, repaint);
+        logMessage(plain.toString());
+
+        knob.setLookAndFeel(nullptr);
+        logMessage("The cached arc repaints " + speedUp(uncached, cached) + "x faster than drawing it, "
+                   + speedUp(plain, cached) + "x faster than LookAndFeel_V4");
+    }
+};
+
+static KnobBenchmark knobBenchmark;
+
+class EditorPaintBenchmark : public juce::UnitTest
+{
+public:
+    EditorPaintBenchmark() : juce::UnitTest("Editor paint benchmark", "JX11") {}
+
+    void runTest() override
+    {
+        constexpr int runs = 100;
+
+        beginTest("Software renderer");
+        JX11AudioProcessor processor;
+        std::unique_ptr<juce::AudioProcessorEditor> editor(processor.createEditor());
+        juce::Image image(juce::Image::ARGB, editor->getWidth(), editor->getHeight(), true);
+
+        auto paint = [&] {
+            juce::Graphics g(image);
+            editor->paintEntireComponent(g, false);
+        };
+        paint();
+        auto stats = measure("Editor repaint", runs, paint);
+        logMessage(stats.toString());
+        logMessage("A full repaint takes " + juce::String(stats.averageSeconds * 6000.0, 1)
+                   + "% of a frame at 60 Hz");
+
+        editor = nullptr;
+    }
+};
+
+static EditorPaintBenchmark editorPaintBenchmark;
+
+class EditorOpenBenchmark : public juce::UnitTest
+{
+public:
+    EditorOpenBenchmark() : juce::UnitTest("Editor open benchmark", "JX11") {}
+
+    void runTest() override
+    {
+        constexpr int runs = 20;
+
+        beginTest("createEditor() and first paint");
+        JX11AudioProcessor processor;
+        juce::PerformanceCounter create("createEditor()", std::numeric_limits<int>::max());
+        juce::PerformanceCounter firstPaint("First paint", std::numeric_limits<int>::max());
+
+        for (int i = 0; i < runs; ++i) {
+//            The way a host opens it.
+            create.start();
+            std::unique_ptr<juce::AudioProcessorEditor> editor(processor.createEditorAndMakeActive());
+            create.stop();
+
+            firstPaint.start();
+            juce::Image image(juce::Image::ARGB, editor->getWidth(), editor->getHeight(), true);
+            {
+                juce::Graphics g(image);
+                editor->paintEntireComponent(g, false);
+            }
+            firstPaint.stop();
+
+            expect(processor.getActiveEditor() == editor.get());
+        }
+
+        auto createStats = create.getStatisticsAndReset();
+        auto paintStats = firstPaint.getStatisticsAndReset();
+        logMessage(createStats.toString());
+        logMessage(paintStats.toString());
+        logMessage("Editor open: " + juce::String((createStats.averageSeconds + paintStats.averageSeconds) * 1000.0, 2)
+                   + " ms");
+    }
+};
+
+static EditorOpenBenchmark editorOpenBenchmark;
@@ -0,0 +1,54 @@
+/*
+  ==============================================================================
+
+    InstanceBenchmark.cpp
+    Created: 18 Oct 2026 10:52:40pm
+    Author:  MacJay
+
+    How long it takes to create a JX11AudioProcessor, as a host does
+    for every instance when it opens a project. The first instance
+    also creates the SharedResources, the others share them.
+
+  ==============================================================================
+*/
+
+#include "../Source/PluginProcessor.h"
+#include "Benchmark.h"
+
+class InstanceBenchmark : public juce::UnitTest
+{
+public:
+    InstanceBenchmark() : juce::UnitTest("Instance benchmark", "JX11") {}
+
+    void runTest() override
+    {
+        constexpr int numInstances = 50;
+
+        beginTest("First instance");
+        std::unique_ptr<JX11AudioProcessor> first;
+        auto firstStats = measure("First instance", 1, [&] {
+            first = std::make_unique<JX11AudioProcessor>();
+        });
+        logMessage(firstStats.toString());
+
+        beginTest(juce::String(numInstances) + " instances");
+        std::vector<std::unique_ptr<JX11AudioProcessor>> instances;
+        instances.reserve(size_t(numInstances));
+        auto stats = measure("Construction", numInstances, [&] {
+            instances.push_back(std::make_unique<JX11AudioProcessor>());
+        });
+        logMessage(stats.toString());
+        logMessage("Per instance: " + juce::String(stats.averageSeconds * 1000.0, 3) + " ms");
+
+        for (const auto& instance : instances) {
+            expectEquals(instance->getCurrentProgram(), 0);
+        }
+
+        auto destruction = measure("Destruction", numInstances, [&] {
+            instances.pop_back();
+        });
+        logMessage(destruction.toString());
+    }
+};
+
+static InstanceBenchmark instanceBenchmark;
@@ -0,0 +1,50 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Created: 18 Oct 2026 10:05:41pm
+    Author:  MacJay
+
+    Console app that runs the unit tests and benchmarks of JX11, all
+    in the category "JX11". A test name on the command line runs only
+    that test, for example: JX11Tests "Realtime stress"
+
+    The exit code is 1 if any test failed, so a build script can
+    run it after building.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../Source/RealtimeCheck.h"
+
+#if ! JX11_REALTIME_CHECKS
+ #error "The tests are built with JX11_REALTIME_CHECKS=1, see JX11Tests.jucer"
+#endif
+
+int main(int argc, char* argv[])
+{
+//    The editor tests need the message manager and the GUI classes.
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure(false);
+    
+    if (argc > 1) {
+        juce::Array<juce::UnitTest*> tests;
+        for (auto* test : juce::UnitTest::getTestsInCategory("JX11")) {
+            if (test->getName() == juce::String(argv[1])) {
+                tests.add(test);
+            }
+        }
+        runner.runTests(tests);
+    } else {
+        runner.runTestsInCategory("JX11");
+    }
+    
+    int failures = 0;
+    for (int i = 0; i < runner.getNumResults(); ++i) {
+        failures += runner.getResult(i)->failures;
+    }
+    return (failures > 0) ? 1 : 0;
+}
@@ -0,0 +1,115 @@
+/*
+  ==============================================================================
+
+    RealtimeStressTest.cpp
+    Created: 18 Oct 2026 9:12:05pm
+    Author:  MacJay
+
+    Runs the processor through every factory preset with a stream of
+    MIDI that touches all the paths of the audio thread: notes, sustain,
+    pitch bend, pressure, mapped controllers, program changes, MPE,
+    the multi-timbral parts, the limiter and the on-screen keyboard.
+
+    The test app (JX11Tests.jucer) is built with JX11_REALTIME_CHECKS=1,
+    where any allocation or blocking call inside processBlock() aborts
+    the test.
+
+  ==============================================================================
+*/
+
+#include "../Source/PluginProcessor.h"
+#include "../Source/FactoryPresets.h"
+
+class RealtimeStressTest : public juce::UnitTest
+{
+public:
+    RealtimeStressTest() : juce::UnitTest("Realtime stress", "JX11") {}
+
+    void runTest() override
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int blockSize = 512;
+        constexpr int blocksPerPreset = 40;
+
+        JX11AudioProcessor processor;
+        processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+        processor.prepareToPlay(sampleRate, blockSize);
+
+        juce::AudioBuffer<float> buffer(processor.getTotalNumOutputChannels(), blockSize);
+        juce::MidiBuffer midi;
+        juce::Random random(1234);
+
+//        Every combination of the modes that change the MIDI routing.
+        for (int mode = 0; mode < 8; ++mode) {
+            processor.mpe = (mode & 1) != 0;
+            processor.multiTimbral = (mode & 2) != 0;
+            processor.setLimiterEnabled((mode & 4) != 0);
+            beginTest("Mode " + juce::String(mode));
+
+            for (int program = 0; program < NUM_PRESETS; ++program) {
+//                Message thread, outside the realtime scope.
+                processor.setCurrentProgram(program);
+
+                for (int block = 0; block < blocksPerPreset; ++block) {
+//                    The MIDI is built before processBlock(), since
+//                    filling a MidiBuffer may allocate.
+                    midi.clear();
+                    addRandomMidi(midi, random, blockSize);
+                    if (random.nextInt(8) == 0) {
+                        processor.getEditorMidi().push(MidiEvent::fromBytes(0x90, uint8_t(random.nextInt(128)), 100));
+                    }
+
+                    processor.processBlock(buffer, midi);
+                    expectOutputIsSafe(buffer, processor.limiterEnabled.load());
+                }
+            }
+        }
+
+        processor.releaseResources();
+    }
+
+private:
+    static void addRandomMidi(juce::MidiBuffer& midi, juce::Random& random, int blockSize)
+    {
+        int numEvents = random.nextInt(24);
+        for (int i = 0; i < numEvents; ++i) {
+            int channel = random.nextInt(16);
+            auto data1 = uint8_t(random.nextInt(128));
+            auto data2 = uint8_t(random.nextInt(128));
+            uint8_t status = 0;
+            switch (random.nextInt(9)) {
+                case 0: status = 0x80; break;
+                case 1:
+                case 2: status = 0x90; break;
+                case 3: status = 0xA0; break;
+//                    Sustain, the mapped Filter Reso controller,
+//                    the MPE timbre and anything else.
+                case 4: {
+                    status = 0xB0;
+                    const uint8_t controllers[] = { 0x40, 0x47, 0x4A, 0x01, 0x21, 0x7B };
+                    data1 = controllers[random.nextInt(6)];
+                    break;
+                }
+                case 5: status = 0xC0; break;
+                case 6: status = 0xD0; break;
+                default: status = 0xE0; break;
+            }
+            uint8_t bytes[3] = { uint8_t(status | channel), data1, data2 };
+            int numBytes = (status == 0xC0 || status == 0xD0) ? 2 : 3;
+            midi.addEvent(bytes, numBytes, random.nextInt(blockSize));
+        }
+    }
+
+    void expectOutputIsSafe(const juce::AudioBuffer<float>& buffer, bool limiting)
+    {
+//        The limiter allows a little headroom for the interpolated peak.
+        float maximum = limiting ? OutputStage::ceiling * 1.01f : 1.0f;
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel) {
+            auto scan = OutputStage::scan(buffer.getReadPointer(channel), buffer.getNumSamples());
+            expect(scan.finite, "Output is not finite");
+            expect(scan.peak <= maximum, "Output peak " + juce::String(scan.peak));
+        }
+    }
+};
+
+static RealtimeStressTest realtimeStressTest;
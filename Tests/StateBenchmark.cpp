@@ -0,0 +1,83 @@
+/*
+  ==============================================================================
+
+    StateBenchmark.cpp
+    Created: 18 Oct 2026 10:38:27pm
+    Author:  MacJay
+
+    Saving and loading the state as the binary chunk, against the XML
+    that JX11 used to save. The XML is made here the way the old
+    getStateInformation() made it and loaded through setStateFromXml(),
+    which JX11 still uses for states from older versions.
+
+  ==============================================================================
+*/
+
+#include "../Source/PluginProcessor.h"
+#include "Benchmark.h"
+
+class StateBenchmark : public juce::UnitTest
+{
+public:
+    StateBenchmark() : juce::UnitTest("State benchmark", "JX11") {}
+
+    void runTest() override
+    {
+        constexpr int runs = 500;
+
+        JX11AudioProcessor processor;
+        processor.setCurrentProgram(3);
+
+        beginTest("Binary");
+        juce::MemoryBlock binary;
+        auto binarySave = measure("getStateInformation()", runs, [&] {
+            binary.reset();
+            processor.getStateInformation(binary);
+        });
+        auto binaryLoad = measure("setStateInformation()", runs, [&] {
+            processor.setStateInformation(binary.getData(), int(binary.getSize()));
+        });
+        logMessage(binarySave.toString());
+        logMessage(binaryLoad.toString());
+        logMessage("Binary state: " + juce::String(binary.getSize()) + " bytes");
+
+//        Loading the chunk keeps what was saved.
+        juce::MemoryBlock reloaded;
+        processor.getStateInformation(reloaded);
+        expectEquals(int(reloaded.getSize()), int(binary.getSize()));
+        expectEquals(processor.getCurrentProgram(), 3);
+
+        beginTest("XML");
+        juce::MemoryBlock xml;
+        auto xmlSave = measure("XML save", runs, [&] {
+            xml.reset();
+            getXmlState(processor, xml);
+        });
+        auto xmlLoad = measure("XML load", runs, [&] {
+            processor.setStateInformation(xml.getData(), int(xml.getSize()));
+        });
+        logMessage(xmlSave.toString());
+        logMessage(xmlLoad.toString());
+        logMessage("XML state: " + juce::String(xml.getSize()) + " bytes");
+
+        expect(binary.getSize() < xml.getSize(), "The binary state is larger than the XML");
+        logMessage("Binary save is " + speedUp(xmlSave, binarySave) + "x faster, load is "
+                   + speedUp(xmlLoad, binaryLoad) + "x faster");
+    }
+
+private:
+//    What getStateInformation() used to do.
+    static void getXmlState(JX11AudioProcessor& processor, juce::MemoryBlock& destData)
+    {
+        juce::XmlElement xml("PLUGIN");
+        xml.addChildElement(processor.apvts.copyState().createXml().release());
+
+        auto* extraXML = new juce::XmlElement("EXTRA");
+        extraXML->setAttribute("midiCC", 0x47);
+        xml.addChildElement(extraXML);
+
+        juce::AudioProcessor::copyXmlToBinary(xml, destData);
+    }
+};
+
+static StateBenchmark stateBenchmark;